@@ -0,0 +1,248 @@
+#ifndef MYRPC_CHANNEL_H
+#define MYRPC_CHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <initializer_list>
+
+#include "noncopyable.h"
+#include "spinlock.h"
+#include "fiber/lockfree_queue.h"
+
+namespace MyRPC{
+    class Fiber;
+    class ChannelBase;
+
+    /**
+     * @brief Select中的一个分支，由Channel::SendCase()或Channel::RecvCase()创建
+     */
+    struct SelectCase{
+        ChannelBase* m_channel;
+        bool m_is_send;
+        void* m_data; // 发送分支为待发送的数据（成功时被移走），接收分支为接收数据的位置
+        bool* m_ok; // 分支完成时写入是否成功（通道已关闭时为false），可以为nullptr
+    };
+
+    /**
+     * @brief 等待多个通道中的任意一个分支完成
+     * @param cases 分支列表，多个分支同时可以完成时随机选择一个
+     * @param timeout_us 超时时间（微秒），-1表示一直等待，0表示不等待
+     * @return 完成的分支下标，超时返回-1。发送或接收分支所在的通道已关闭时，该分支也会完成，*m_ok为false
+     * @note 协程池中的协程在所有分支都无法完成时阻塞，不在协程池中的线程让出CPU并重试
+     */
+    int Select(std::initializer_list<SelectCase> cases, int64_t timeout_us = -1);
+
+    /**
+     * @brief 通道中与元素类型无关的部分：等待者队列、直接交接、关闭以及Select的实现
+     * @note 缓冲区的无锁快速路径在Channel<T, N>中实现，只有缓冲区满/空、或者有协程在等待时才获取m_lock。
+     *       快速路径的发送者写入缓冲区后检查是否有等待的接收者，等待者在m_lock中加入队列后再检查缓冲区，
+     *       两侧之间有seq_cst栅栏，保证至少有一方能看到对方
+     */
+    class ChannelBase: public NonCopyable{
+    public:
+        virtual ~ChannelBase();
+
+        /**
+         * @brief 关闭通道，唤醒所有等待的协程
+         * @note 关闭之后Send返回false，Recv在取完缓冲区中剩余的数据后返回false。与Close并发的Send可能仍然成功
+         */
+        void Close();
+
+        bool IsClosed() const{ return m_closed.load(std::memory_order_acquire); }
+
+    protected:
+        enum OpResult{
+            OP_OK = 0,
+            OP_CLOSED = 1,
+            OP_WOULD_BLOCK = 2
+        };
+
+        // 缓冲区操作，由Channel<T, N>实现。ring_push成功时移走*value，ring_pop成功时将数据移入*out
+        virtual bool ring_push(void* value) = 0;
+        virtual bool ring_pop(void* out) = 0;
+        virtual bool ring_can_push() const = 0;
+        virtual bool ring_can_pop() const = 0;
+        // *dst = std::move(*src)
+        virtual void move_value(void* dst, void* src) = 0;
+
+        // 快速路径失败后，在m_lock中尝试发送/接收，不阻塞
+        OpResult try_send_slow(void* value);
+        OpResult try_recv_slow(void* out);
+
+        // 快速路径写入缓冲区后，若有等待的接收者，将缓冲区中的数据交给其中一个
+        void on_item_pushed(){
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_recv_waiters.Size() > 0) wake_receiver();
+        }
+        // 快速路径从缓冲区取出数据后，若有等待的发送者，将其数据移入缓冲区
+        void on_slot_freed(){
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_send_waiters.Size() > 0) wake_sender();
+        }
+
+        bool has_recv_waiters() const{ return m_recv_waiters.Size() > 0; }
+
+    private:
+        friend int Select(std::initializer_list<SelectCase> cases, int64_t timeout_us);
+
+        // 一次Select的等待状态，由该Select在各个通道上注册的等待者共享
+        struct SelectState{
+            std::atomic<bool> m_done {false}; // 第一个将其置为true的一方负责唤醒协程
+            Fiber* m_fiber = nullptr; // 持有协程的一个引用
+            int m_index = -1; // 完成的分支下标
+            bool m_ok = false; // 数据是否已经交接完成，为false时协程重新尝试所有分支
+        };
+
+        // 注册在通道等待队列中的分支，位于等待协程的栈上
+        struct Waiter{
+            Waiter* m_prev = nullptr;
+            Waiter* m_next = nullptr;
+            bool m_linked = false;
+
+            SelectState* m_select = nullptr;
+            void* m_data = nullptr;
+            int m_index = -1;
+        };
+
+        // 侵入式双向链表，Select完成后需要从其他通道的队列中间删除等待者
+        class WaitList{
+        public:
+            void Push(Waiter* waiter);
+            void Remove(Waiter* waiter);
+            Waiter* Front() const{ return m_head; }
+            int Size() const{ return m_size.load(std::memory_order_relaxed); }
+
+        private:
+            Waiter* m_head = nullptr;
+            Waiter* m_tail = nullptr;
+            std::atomic<int> m_size {0};
+        };
+
+        SpinLock m_lock;
+        std::atomic<bool> m_closed {false};
+        WaitList m_send_waiters;
+        WaitList m_recv_waiters;
+
+        // 从等待队列中取出一个仍在等待的分支并标记为完成，没有时返回nullptr
+        static Waiter* claim_waiter(WaitList& list);
+
+        // 等待队列中是否有属于其他Select、且仍在等待的分支
+        static bool has_other_waiter(const WaitList& list, const SelectState* select);
+
+        // 完成waiter所在的Select，返回需要在释放锁之后唤醒的协程
+        static Fiber* finish(Waiter* waiter, bool ok);
+
+        void wake_receiver();
+        void wake_sender();
+
+        // 在通道上注册等待者，返回false表示注册期间分支已经可以完成（或通道已关闭），不需要阻塞
+        bool register_waiter(Waiter* waiter, bool is_send);
+        void unregister_waiter(Waiter* waiter, bool is_send);
+    };
+
+    /**
+     * @brief 协程级的有界通道
+     * @tparam T 元素类型，需要可移动构造和移动赋值
+     * @tparam N 缓冲区大小，0表示无缓冲通道（发送者和接收者直接交接）
+     * @note 缓冲区是MPMCLockFreeQueue，缓冲区未满/非空且没有协程等待时，Send/Recv不获取锁。
+     *       缓冲区满时发送者阻塞（背压），缓冲区空时接收者阻塞；有接收者在等待时，发送者直接将数据交给等待时间最长的接收者并唤醒它，
+     *       不经过缓冲区
+     */
+    template<class T, size_t N>
+    class Channel: public ChannelBase{
+    public:
+        /**
+         * @brief 发送数据，缓冲区满时阻塞
+         * @return 通道已关闭时返回false，此时value不会被移走
+         */
+        bool Send(T value){
+            if(fast_send(value)) return true;
+            bool ok;
+            Select({SendCase(value, &ok)});
+            return ok;
+        }
+
+        /**
+         * @brief 不阻塞地发送数据
+         * @return 缓冲区已满且没有等待的接收者、或者通道已关闭时返回false，此时value不会被移走
+         */
+        bool TrySend(T& value){
+            return fast_send(value) || try_send_slow(&value) == OP_OK;
+        }
+
+        /**
+         * @brief 接收数据，缓冲区空时阻塞
+         * @return 通道已关闭且缓冲区为空时返回false
+         */
+        bool Recv(T& out){
+            if(fast_recv(out)) return true;
+            bool ok;
+            Select({RecvCase(out, &ok)});
+            return ok;
+        }
+
+        /**
+         * @brief 不阻塞地接收数据
+         * @return 缓冲区为空且没有等待的发送者、或者通道已关闭且缓冲区为空时返回false
+         */
+        bool TryRecv(T& out){
+            return fast_recv(out) || try_recv_slow(&out) == OP_OK;
+        }
+
+        SelectCase SendCase(T& value, bool* ok = nullptr){ return {this, true, &value, ok}; }
+        SelectCase RecvCase(T& out, bool* ok = nullptr){ return {this, false, &out, ok}; }
+
+        constexpr size_t Capacity() const{ return N; }
+
+    private:
+        static constexpr size_t RING_SIZE = N > 0 ? N : 1;
+
+        MPMCLockFreeQueue<T, RING_SIZE> m_ring;
+
+        bool fast_send(T& value){
+            if(IsClosed()) return false;
+            // 有接收者在等待时，由慢速路径直接交接
+            if(has_recv_waiters() || !ring_try_push(value)) return false;
+            on_item_pushed();
+            return true;
+        }
+
+        bool fast_recv(T& out){
+            if(!ring_try_pop(out)) return false;
+            on_slot_freed();
+            return true;
+        }
+
+        // 成功时移走value，失败时value不变
+        bool ring_try_push(T& value){
+            if constexpr (N == 0) return false;
+            return m_ring.TryPush(std::move(value));
+        }
+
+        bool ring_try_pop(T& out){
+            if constexpr (N == 0) return false;
+            return m_ring.TryPop(out);
+        }
+
+        bool ring_push(void* value) override{ return ring_try_push(*static_cast<T*>(value)); }
+        bool ring_pop(void* out) override{ return ring_try_pop(*static_cast<T*>(out)); }
+
+        bool ring_can_push() const override{
+            if constexpr (N == 0) return false;
+            return m_ring.CanPush();
+        }
+
+        bool ring_can_pop() const override{
+            if constexpr (N == 0) return false;
+            return m_ring.CanPop();
+        }
+
+        void move_value(void* dst, void* src) override{
+            *static_cast<T*>(dst) = std::move(*static_cast<T*>(src));
+        }
+    };
+}
+
+#endif //MYRPC_CHANNEL_H
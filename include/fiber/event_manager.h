@@ -2,14 +2,14 @@
 #define MYRPC_EVENT_MANAGER_H
 
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
 #include <functional>
-#include <array>
 #include "fiber.h"
 
 #include "noncopyable.h"
-#include "lockfree_queue.h"
+#include "fiber/task_queue.h"
+#include "fiber/timing_wheel.h"
+#include "fiber/io_uring.h"
 
 namespace MyRPC{
 
@@ -17,9 +17,19 @@ namespace MyRPC{
     public:
         static const int MAX_EVENTS = 300;
         static const int TIME_OUT = 5000;
-        static const int TASK_QUEUE_SIZE = 1024;
+        static const int TASK_QUEUE_SIZE = 1024; // 可窃取任务队列中环形队列的大小，超出后溢出到链表
+        static const unsigned IO_URING_ENTRIES = 256; // io_uring提交队列的大小
+        static const int FD_TABLE_INIT_SIZE = 1024; // fd等待表的初始大小，之后按需扩充
 
-        EventManager();
+        enum IOBackend{
+            EPOLL_BACKEND = 0, // 等待fd就绪后再调用系统调用
+            IO_URING_BACKEND = 1 // 通过io_uring提交IO请求，请求完成后恢复协程执行。内核不支持io_uring时退回到EPOLL_BACKEND
+        };
+
+        /**
+         * @param backend[in] 被hook的IO函数使用的后端
+         */
+        EventManager(IOBackend backend = EPOLL_BACKEND);
         ~EventManager();
 
         enum EventType{
@@ -35,6 +45,16 @@ namespace MyRPC{
          */
         int AddIOEvent(int fd, EventType event);
 
+        /**
+         * @brief 以边缘触发的方式添加IO事件，该方法必须由协程调用
+         * @param fd[in] 文件描述符
+         * @param event[in] IO事件类型
+         * @return 0表示成功, -1表示失败
+         * @note fd在当前线程的epoll中只注册一次（EPOLLIN|EPOLLOUT|EPOLLET），直到fd被关闭，之后只记录等待的协程，不再调用epoll_ctl。
+         *       调用者必须先以非阻塞方式尝试过IO操作并得到EAGAIN，被唤醒后需要重新尝试（唤醒不保证IO操作一定能完成）
+         */
+        int AddEdgeTriggeredIOEvent(int fd, EventType event);
+
         int AddWakeupEventfd(int fd);
 
         /**
@@ -52,12 +72,52 @@ namespace MyRPC{
          */
         bool IsExistIOEvent(int fd, EventType event) const;
 
+        /**
+         * @brief 为当前协程添加定时器事件，超时后恢复协程执行，该方法必须由协程调用
+         * @param timeout_us[in] 超时时间，单位微秒
+         * @note 每个协程同一时刻最多只能有一个定时器事件
+         */
+        void AddTimerEvent(uint64_t timeout_us);
+
+        /**
+         * @brief 删除当前协程的定时器事件，该方法必须由协程调用。如果定时器已经超时，则不做任何事
+         */
+        void RemoveTimerEvent();
+
+        /**
+         * @brief 检查当前协程是否在等待定时器事件，该方法必须由协程调用
+         */
+        bool IsExistTimerEvent() const;
+
+        /**
+         * @brief 获得实际使用的IO后端
+         */
+        IOBackend GetIOBackend() const{ return m_io_uring.IsInitialized() ? IO_URING_BACKEND : EPOLL_BACKEND; }
+
+        /**
+         * @brief 当前协程能否通过io_uring提交IO请求，该方法必须由协程调用
+         * @note 共享栈协程的缓冲区在协程让出CPU后可能被换出，因此不能使用io_uring
+         */
+        bool IsIOUringAvailable() const;
+
+        /**
+         * @brief 通过io_uring提交IO请求，并阻塞当前协程直至请求完成，该方法必须由协程调用
+         * @param opcode[in] IO操作，参数的含义与io_uring_sqe中的同名字段相同
+         * @param off[in] 偏移量，对于accept为addrlen指针(addr2)，对于connect为addrlen
+         * @param op_flags[in] rw_flags/msg_flags/accept_flags
+         * @return 请求的结果，失败时为-errno
+         * @note 提交队列中的请求在线程的每一轮调度中批量提交给内核
+         */
+        int IOUringRequest(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t off, uint32_t op_flags);
+
         void Notify();
 
         /**
          * @brief 处理Epoll事件
+         * @param timeout 最长等待时间（毫秒），-1表示等待到下一个定时器超时（最多TIME_OUT），0表示不等待
+         * @return epoll_wait返回的事件数量
          */
-        void WaitEvent(int thread_id);
+        int WaitEvent(int thread_id, int timeout = -1);
 
         friend class FiberPool;
 
@@ -66,13 +126,70 @@ namespace MyRPC{
 
         int m_notify_event_fd; // 用于从epoll_wait中唤醒
 
-        // m_adder_map: fd -> (READ Fiber, WRITE Fiber)
-        // m_adder_map: 可以根据文件描述符查到谁添加了读/写IO事件
-        std::unordered_map<int, std::array<Fiber::ptr,2>> m_adder_map;
-        std::unordered_set<int> m_wake_up_set;
+        // fd在当前线程上的等待状态
+        struct FdWaiter{
+            enum Flag: uint8_t{
+                WAKEUP_FD = 1,     // 用于从epoll_wait中唤醒的eventfd
+                EDGE_TRIGGERED = 2 // 以边缘触发方式持久注册在epoll中
+            };
+            Fiber::ptr fibers[2]; // 等待读/写事件的协程，水平触发方式注册的fd在epoll中注册的事件与之对应
+            uint32_t generation = 0; // 以边缘触发方式注册时fd的代数（见FdState）
+            uint8_t flags = 0;
+        };
+        // m_fd_table: 以fd为下标，可以根据文件描述符查到谁添加了读/写IO事件。按需扩充，不需要哈希
+        // 等待定时器事件的协程由时间轮管理（Fiber本身就是时间轮的节点），因此这里不需要保存定时器
+        std::vector<FdWaiter> m_fd_table;
+
+        // 等待定时器事件的协程，时间轮中的每个协程持有一个引用
+        TimingWheel m_timing_wheel;
+
+        // io_uring实例，以及已提交但还没有完成的请求数量（每个请求持有协程的一个引用）
+        IOUring m_io_uring;
+        unsigned m_io_uring_inflight = 0;
+
+        // 线程的任务队列，队列中的每个Fiber*持有协程的一个引用
+        // m_local_queue: 只由当前线程访问的本地队列，当前线程上的协程让出CPU或被IO事件唤醒后放入该队列
+        // m_inbox: 其他线程向当前线程提交的协程，由当前线程批量移入本地队列
+        // m_stealable_queue: 可以被其他空闲线程窃取的协程（开启工作窃取时，由当前线程从本地队列中发布）
+        LocalTaskQueue<Fiber> m_local_queue;
+        MPSCTaskQueue<Fiber> m_inbox;
+        TaskQueue<Fiber, TASK_QUEUE_SIZE> m_stealable_queue;
+
+        // 线程是否休眠（即将或正在等待epoll事件），只有休眠的线程才需要通过eventfd唤醒
+        std::atomic<bool> m_sleeping {false};
+        std::atomic<uint64_t> m_wakeup_count {0}; // 通过eventfd唤醒的次数
+
+        // 空闲自旋（见FiberPool::SetIdlePolicy）的状态和统计信息
+        useconds_t m_spin_us = 0; // 当前的自旋时长，根据自旋的命中情况自适应调整
+        std::atomic<uint64_t> m_spin_count {0}; // 空闲自旋的次数
+        std::atomic<uint64_t> m_spin_hit_count {0}; // 自旋期间等到了新的协程或IO事件的次数
+        std::atomic<uint64_t> m_park_count {0}; // 在epoll_wait中休眠的次数
+
+        // 工作窃取的统计信息
+        std::atomic<uint64_t> m_steal_count {0}; // 成功窃取的次数
+        std::atomic<uint64_t> m_stolen_fiber_count {0}; // 窃取到的协程数量
+        std::atomic<uint64_t> m_steal_fail_count {0}; // 没有窃取到协程的次数
+
+        // 将就绪的协程放入本地队列，必须由当前线程调用
+        void schedule(Fiber* fiber){ m_local_queue.Push(fiber); }
+
+        // 由其他线程向当前线程提交协程，提交后需要调用Notify()唤醒当前线程
+        void submit(Fiber* fiber){ m_inbox.Push(fiber); }
+
+        // 将收件箱中的协程全部移入本地队列，返回移入的协程数量，必须由当前线程调用
+        size_t drain_inbox();
+
+        // 恢复已超时的定时器事件对应的协程，必须由当前线程调用
+        void process_timers(int thread_id);
+
+        // 获得fd的等待状态，fd超出m_fd_table的范围时扩充m_fd_table。扩充后之前获得的引用失效
+        FdWaiter& get_fd_waiter(int fd);
+
+        // 恢复被IO事件唤醒的协程，协程再次让出CPU或执行完成后放入本地队列
+        void resume_io_fiber(Fiber::ptr& fiber, int thread_id);
 
-        // 线程的任务队列
-        MPMCLockFreeQueue<Fiber::ptr*, TASK_QUEUE_SIZE> m_task_queue;
+        // 批量提交io_uring请求，并恢复请求已完成的协程，必须由当前线程调用
+        void process_io_uring(int thread_id);
     };
 
 }
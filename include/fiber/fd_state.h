@@ -0,0 +1,58 @@
+#ifndef MYRPC_FD_STATE_H
+#define MYRPC_FD_STATE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace MyRPC{
+    /**
+     * @brief 记录每个文件描述符的状态，所有线程共享。状态包括fd被关闭的次数（代数）和hook函数缓存的标志位
+     * @note 文件描述符关闭后编号会被复用。EventManager在epoll中持久注册fd时记录当时的代数，
+     *       代数不一致说明原来的fd已被关闭（内核已将其从epoll中删除），需要重新注册。fd失效时标志位被清空
+     */
+    class FdState{
+    public:
+        static const int MAX_FD = 1 << 22; // 超出该值的fd不记录状态
+        static const int CHUNK_SIZE = 4096;
+
+        enum Flag: uint32_t{
+            CHECKED = 1,       // 已经检查过fd的类型
+            SOCKET = 2,        // fd是socket
+            HOOK_NONBLOCK = 4, // O_NONBLOCK是由hook函数设置的，对用户仍表现为阻塞
+            REGULAR_FILE = 8,  // fd是普通文件，读写可能因磁盘IO阻塞线程，且无法通过epoll等待
+        };
+        static const int FLAG_BITS = 4;
+
+        /**
+         * @brief 获得fd当前的代数
+         */
+        static uint32_t GetGeneration(int fd);
+
+        /**
+         * @brief 获得fd的标志位
+         */
+        static uint32_t GetFlags(int fd);
+
+        /**
+         * @brief 设置fd的标志位（与已有的标志位按位或）
+         */
+        static void SetFlags(int fd, uint32_t flags);
+
+        /**
+         * @brief fd被关闭、或者fd的编号指向了新的文件时，增加其代数并清空标志位
+         * @note 由hook的close、dup2/dup3函数以及返回新fd的hook函数（socket、accept等）调用。
+         *       绕过hook的关闭（例如fclose、syscall(SYS_close)）无法被发现，因此缓存的标志位在使用前仍需验证
+         */
+        static void Invalidate(int fd);
+
+        static bool IsTracked(int fd){ return fd >= 0 && fd < MAX_FD; }
+
+    private:
+        // 按块分配的状态数组，块在第一次被访问时分配。每一项的高位为代数，低FLAG_BITS位为标志位
+        static std::atomic<std::atomic<uint32_t>*> s_chunks[MAX_FD / CHUNK_SIZE];
+
+        static std::atomic<uint32_t>* get_chunk(int fd);
+    };
+}
+
+#endif //MYRPC_FD_STATE_H
@@ -3,16 +3,31 @@
 
 #include <memory>
 #include <functional>
+#include <csignal>
 
 #include "noncopyable.h"
+#include "intrusive_ptr.h"
+#include "fiber/stack_pool.h"
+#include "fiber/task.h"
+#include "fiber/task_queue.h"
+#include "fiber/timing_wheel.h"
 
 namespace MyRPC {
-    class Fiber : public NonCopyable, public std::enable_shared_from_this<Fiber>{
+    class FiberPool;
+
+    /**
+     * @note 协程对象使用侵入式引用计数，Fiber::ptr不需要额外分配控制块。
+     *       协程池的任务队列中保存持有一个引用的裸指针Fiber*，入队和出队时转移所有权而不修改引用计数。
+     *       协程通过TaskQueueNode串联在任务队列中，同一时刻最多只在一个任务队列中。
+     *       协程通过TimerNode串联在所在线程的时间轮中，定时器节点保存在协程对象内，不受协程栈类型的影响
+     */
+    class Fiber : public NonCopyable, public RefCounted<Fiber>, public TaskQueueNode, public TimerNode{
     public:
-        using ptr = std::shared_ptr<Fiber>;
+        using ptr = IntrusivePtr<Fiber>;
         using unique_ptr = std::unique_ptr<Fiber>;
 
-        const size_t init_stack_size = 8192;
+        static const size_t DEFAULT_STACK_SIZE = 8192;
+        static const size_t SHARED_STACK_SIZE = 1024 * 1024; // 每个线程共享栈的大小
 
         enum status{
             READY = 1,
@@ -24,9 +39,14 @@ namespace MyRPC {
 
         /**
          * @param[in] func 协程中运行的函数
+         * @param[in] stack_size 协程栈大小，0表示使用默认大小DEFAULT_STACK_SIZE
+         * @param[in] stack_type 协程栈的分配方式，MMAP_STACK的协程栈带有保护页，且物理内存在使用时才分配
+         * @note SHARED_STACK协程忽略stack_size，在线程的共享栈上运行，让出CPU后只占用与实际栈使用量相当的内存。
+         *       共享栈协程只能在第一次运行它的线程上恢复执行，且其栈上的变量不能被其他协程访问
+         *       （其他协程运行时，这些变量可能已被换出到保存缓冲区中）
          */
-        Fiber(const std::function<void()>& func);
-        Fiber(std::function<void()>&& func);
+        Fiber(Task&& func, size_t stack_size = 0,
+              StackPool::StackType stack_type = StackPool::MALLOC_STACK);
         ~Fiber();
 
         /**
@@ -70,6 +90,17 @@ namespace MyRPC {
          */
         int64_t GetId(){return m_fiber_id;}
 
+        /**
+         * @brief 设置协程是否绑定在当前的线程上执行，绑定的协程不会被协程池中的其他线程窃取
+         * @note SHARED_STACK协程总是绑定在第一次运行它的线程上
+         */
+        void SetPinned(bool pinned){m_pinned = pinned;}
+
+        /**
+         * @brief 协程是否绑定在当前的线程上执行
+         */
+        bool IsPinned() const{return m_pinned || m_stack_type == StackPool::SHARED_STACK;}
+
         /**
          * @brief 获得当前协程状态，必须由协程调用
          */
@@ -80,6 +111,10 @@ namespace MyRPC {
          */
          static int64_t GetCurrentId();
 
+         /**
+          * @brief 获得指向当前协程的Fiber::ptr，必须由协程调用
+          * @note 当前协程必须是通过new创建并由Fiber::ptr管理的
+          */
          static Fiber::ptr GetSharedFromThis();
 
          /**
@@ -87,14 +122,20 @@ namespace MyRPC {
           */
          static size_t GetStacksize();
 
+         /**
+          * @brief 获得栈的分配方式，必须由协程调用
+          */
+         static StackPool::StackType GetStackType();
+
          /**
           * @brief 获得栈剩余空间的大小，必须由协程调用
           */
          static size_t GetStackFreeSize();
 
          /**
-          * @brief 将栈空间扩充到两倍，必须由协程调用
-          * @return 返回true表示成功，false表示失败
+          * @brief 将栈空间原地扩充到两倍，必须由协程调用
+          * @return 返回true表示成功，false表示失败。只有GROWABLE_STACK协程栈可以扩充
+          * @note GROWABLE_STACK协程栈访问到尚不可访问的预留空间时，也会在SIGSEGV信号处理函数中自动扩充
           */
          static bool ExtendStackCapacity();
 
@@ -104,10 +145,25 @@ namespace MyRPC {
         // 当前执行状态
         status m_status;
         // 需要执行的函数
-        std::function<void()> m_func;
-        // 协程栈
+        Task m_func;
+        // 协程栈，第一次运行时从StackPool中分配，运行结束后归还
         char* m_stack = nullptr;
         size_t m_stack_size;
+        size_t m_stack_alloc_size = 0; // 分配时的栈大小，GROWABLE_STACK协程栈扩充后m_stack_size会变大
+        StackPool::StackType m_stack_type;
+        bool m_pinned = false; // 是否绑定在当前线程上执行
+
+        // 协程阻塞时所在的协程池和线程，被唤醒时提交回该线程（见FiberPool::PrepareBlock）
+        FiberPool* m_block_pool = nullptr;
+        int m_block_thread_id = -1;
+        friend class FiberPool;
+
+        // 共享栈，以及让出共享栈时保存栈上已使用部分的缓冲区
+        struct SharedStack;
+        std::shared_ptr<SharedStack> m_shared_stack;
+        char* m_save_buffer = nullptr;
+        size_t m_save_size = 0;
+        size_t m_save_capacity = 0;
 
         // 上下文
         // 仅需要保存callee-saved寄存器
@@ -127,6 +183,19 @@ namespace MyRPC {
 #endif
         void init_stack_and_ctx();
 
+        bool alloc_stack();
+        void release_stack();
+
+        // 在恢复协程执行前准备协程栈：私有栈在第一次运行时分配，共享栈需要换出当前占用者并换入本协程的栈
+        bool switch_in_stack();
+        void save_shared_stack();
+        void restore_shared_stack();
+        // 能否在当前位置换入协程栈并进行栈回溯
+        bool can_unwind() const;
+
+        static void install_stack_fault_handler();
+        static void stack_fault_handler(int sig, siginfo_t* info, void* ucontext);
+
         // 协程的主函数
         static void Main();
 
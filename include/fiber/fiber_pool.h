@@ -6,10 +6,15 @@
 #include <list>
 #include <unordered_map>
 #include <atomic>
+#include <optional>
+#include <exception>
+#include <type_traits>
+#include <algorithm>
 
 #include "macro.h"
 #include "spinlock.h"
 #include "fiber/event_manager.h"
+#include "fiber/offload_pool.h"
 
 namespace MyRPC{
     class FiberPool: public NonCopyable {
@@ -18,8 +23,9 @@ namespace MyRPC{
 
         /**
          * @param thread_num[in] 线程数量
+         * @param io_backend[in] 被hook的IO函数使用的后端，选择IO_URING_BACKEND但内核不支持时退回到EPOLL_BACKEND
          */
-        FiberPool(int thread_num);
+        FiberPool(int thread_num, EventManager::IOBackend io_backend = EventManager::EPOLL_BACKEND);
         virtual ~FiberPool();
 
         /**
@@ -36,14 +42,15 @@ namespace MyRPC{
         /**
          * @brief 唤醒正在等待事件的线程（指定线程）
          * @param thread_id 需要唤醒的线程id
+         * @note 只有线程正在（或即将）等待epoll事件时才会写eventfd，线程忙碌时不会产生系统调用
          */
         void Notify(int thread_id){
-            m_threads_context_ptr[thread_id]->Notify();
+            wakeup(thread_id);
         }
 
         /**
          * @brief 唤醒正在等待事件的线程（所有线程）
-         * @note 该方法一次唤醒线程池中的所有线程
+         * @note 该方法逐个唤醒线程池中正在等待事件的线程
          */
         void NotifyAll();
 
@@ -52,26 +59,174 @@ namespace MyRPC{
          */
         void Wait();
 
+        /**
+         * @brief 设置协程池中协程栈的默认大小及分配方式，应在Start()之前调用
+         * @param stack_size 协程栈大小，0表示使用Fiber::DEFAULT_STACK_SIZE
+         * @param stack_type 协程栈的分配方式。使用MMAP_STACK时，协程栈带有保护页，且物理内存在使用时才分配，
+         *                   因此可以设置较大的栈大小而不会成倍增加内存占用
+         */
+        void SetStackAttr(size_t stack_size, StackPool::StackType stack_type = StackPool::MALLOC_STACK){
+            m_stack_size = stack_size;
+            m_stack_type = stack_type;
+        }
+
+        size_t GetStackSize() const{return m_stack_size ? m_stack_size : Fiber::DEFAULT_STACK_SIZE;}
+        StackPool::StackType GetStackType() const{return m_stack_type;}
+
+        /**
+         * @brief 开启或关闭工作窃取，应在Start()之前调用
+         * @note 开启后，未指定线程的协程可以被空闲的线程窃取执行：线程在等待epoll事件之前，先从其他线程的任务队列中窃取就绪的协程；
+         *       有可窃取的协程积压时，也会唤醒空闲的线程。指定了线程、调用了SetPinned(true)或使用SHARED_STACK的协程不会被窃取
+         */
+        void SetWorkStealing(bool enable){m_work_stealing = enable;}
+        bool IsWorkStealing() const{return m_work_stealing;}
+
+        /**
+         * @brief 设置协程池线程的CPU亲和性，应在Start()之前调用
+         * @param cpus CPU编号列表，线程i绑定在cpus[i % cpus.size()]上运行，为空表示不绑定
+         * @note 每个线程的事件管理器（包括任务队列、fd表）在线程绑定CPU之后由线程自己创建，协程栈也由运行它的线程分配，
+         *       按照Linux默认的首次访问（first-touch）策略，这些内存都位于线程所在的NUMA节点上
+         */
+        void SetCpuAffinity(std::vector<int> cpus){m_cpu_affinity = std::move(cpus);}
+        const std::vector<int>& GetCpuAffinity() const{return m_cpu_affinity;}
+
+        enum IdlePolicy{
+            PARK = 0,          // 任务队列为空时立即在epoll_wait中休眠，新的协程需要通过eventfd唤醒线程
+            SPIN_THEN_PARK = 1 // 先自旋一段时间再休眠，自旋期间提交的协程和发生的IO事件不需要唤醒线程
+        };
+
+        static const useconds_t DEFAULT_MAX_SPIN_US = 50; // 默认的最长自旋时间
+
+        /**
+         * @brief 设置线程空闲（任务队列为空）时的等待策略，应在Start()之前调用
+         * @param policy 等待策略。SPIN_THEN_PARK自旋时检查收件箱，并定期以0超时调用epoll_wait轮询IO事件，
+         *               以少量的CPU时间换取更低的唤醒延迟
+         * @param max_spin_us 自旋时长的上限。实际的自旋时长在0到max_spin_us之间自适应调整：自旋等到了新任务、
+         *                    或者休眠后很快被唤醒（自旋更长时间就能等到）时加倍，休眠较长时间后减半
+         */
+        void SetIdlePolicy(IdlePolicy policy, useconds_t max_spin_us = DEFAULT_MAX_SPIN_US){
+            m_idle_policy = policy;
+            m_max_spin_us = max_spin_us;
+        }
+        IdlePolicy GetIdlePolicy() const{return m_idle_policy;}
+
+        struct Statistics{
+            uint64_t steal_count = 0; // 成功窃取的次数
+            uint64_t stolen_fiber_count = 0; // 窃取到的协程数量
+            uint64_t steal_fail_count = 0; // 没有窃取到协程的次数
+
+            uint64_t overflow_count = 0; // 可窃取任务队列的环形队列已满，溢出到链表的入队次数
+            size_t overflow_size = 0; // 当前溢出链表中的协程数量
+            size_t overflow_peak_size = 0; // 溢出链表的最大长度（各线程任务队列最大长度之和）
+
+            uint64_t wakeup_count = 0; // 通过eventfd唤醒休眠线程的次数
+
+            uint64_t spin_count = 0; // 空闲自旋的次数
+            uint64_t spin_hit_count = 0; // 自旋期间等到了新的协程或IO事件的次数，spin_hit_count / spin_count为自旋的命中率
+            uint64_t park_count = 0; // 在epoll_wait中休眠的次数
+        };
+
+        /**
+         * @brief 获得协程池的统计信息
+         * @param thread_id 线程id，-1表示所有线程的统计信息之和
+         */
+        Statistics GetStatistics(int thread_id = -1) const;
+
         /**
          * 运行任务func
          * @param func 任务对应的函数
-         * @param thread_id 将任务指定给线程thread_id执行。若thread_id被设置为-1，表示将任务分配给任意线程执行
+         * @param thread_id 将任务指定给线程thread_id执行，协程会绑定在该线程上。若thread_id被设置为-1，表示将任务分配给任意线程执行。
+         *                  开启工作窃取时，协程池中的协程创建的任务优先放入当前线程的任务队列
+         * @param stack_size 协程栈大小，0表示使用协程池的默认栈大小
+         * @param stack_type 协程栈的分配方式，STACK_TYPE_NUM表示使用协程池的默认分配方式。
+         *                   大量长时间空闲的协程（如等待请求的连接）可以使用SHARED_STACK，让出CPU时只保存实际使用的栈空间
          * @return
          */
         template<class Func>
-        Fiber::ptr Run(Func&& func, int thread_id = -1){
-            if(thread_id == -1)
-                thread_id = rand() % m_threads_num;
-
-            Fiber::ptr* ptr = new Fiber::ptr(new Fiber(std::forward<Func>(func)));
-            if(!m_threads_context_ptr[thread_id]->m_task_queue.TryPush(ptr)){
-                MYRPC_CRITIAL_ERROR("Task queue is full!");
+        Fiber::ptr Run(Func&& func, int thread_id = -1, size_t stack_size = 0,
+                       StackPool::StackType stack_type = StackPool::STACK_TYPE_NUM){
+            Fiber::ptr fiber(new Fiber(std::forward<Func>(func), stack_size ? stack_size : m_stack_size,
+                                       stack_type == StackPool::STACK_TYPE_NUM ? m_stack_type : stack_type));
+            if(thread_id == -1) {
+                if(m_work_stealing && GetThis() == this) thread_id = GetCurrentThreadId();
+                else thread_id = rand() % m_threads_num;
+                fiber->SetPinned(!m_work_stealing);
+            }else{
+                fiber->SetPinned(true);
             }
+
+            // 任务队列持有协程的一个引用
             ++m_tasks_cnt;
-            Notify(thread_id);
-            return *ptr;
+            if(GetThis() == this && GetCurrentThreadId() == thread_id){
+                m_threads_context_ptr[thread_id]->schedule(Fiber::ptr(fiber).detach());
+            }else{
+                m_threads_context_ptr[thread_id]->submit(Fiber::ptr(fiber).detach());
+                Notify(thread_id);
+            }
+            return fiber;
+        }
+
+        /**
+         * @brief 在阻塞IO线程池中执行可能长时间阻塞线程的操作（例如普通文件的读写），当前协程让出CPU，操作完成后在原来的线程上恢复执行
+         * @param func 阻塞操作，在阻塞IO线程池的线程中执行，不能调用协程相关的方法
+         * @return 当前不是协程池中的协程、或者是SHARED_STACK协程时返回false，此时func没有被执行
+         * @note SHARED_STACK协程让出CPU后栈空间会被其他协程使用，func无法访问协程栈上的变量，因此不会被转移执行
+         */
+        bool RunBlockingIO(std::function<void()> func){
+            return run_offloaded(m_blocking_io_pool, std::move(func));
         }
 
+        /**
+         * @brief 在弹性的工作线程池中执行耗时的计算或阻塞操作（例如压缩、大对象的序列化），当前协程让出CPU，
+         *        执行完成后在原来的线程上恢复执行并返回func的结果，期间当前线程可以继续处理其他协程和IO事件
+         * @param func 需要转移执行的函数，在工作线程中执行，不能调用协程相关的方法
+         * @return func的返回值。func抛出的异常会在当前协程中重新抛出
+         * @note 不是协程池中的协程、或者是SHARED_STACK协程时，直接在当前协程中执行func
+         */
+        template<class Func>
+        std::invoke_result_t<Func&> Offload(Func&& func){
+            using ret_type = std::invoke_result_t<Func&>;
+            std::exception_ptr exception;
+            if constexpr (std::is_void_v<ret_type>){
+                if(!run_offloaded(m_offload_pool, [&func, &exception](){
+                    try{ func(); }
+                    catch(...){ exception = std::current_exception(); }
+                })) return func();
+                if(exception) std::rethrow_exception(exception);
+            }else{
+                std::optional<ret_type> ret_val;
+                if(!run_offloaded(m_offload_pool, [&func, &ret_val, &exception](){
+                    try{ ret_val.emplace(func()); }
+                    catch(...){ exception = std::current_exception(); }
+                })) return func();
+                if(exception) std::rethrow_exception(exception);
+                return std::move(*ret_val);
+            }
+        }
+
+        /**
+         * @brief 设置Offload()使用的工作线程池，应在Start()之前调用
+         * @param max_threads 线程数量的上限，默认为CPU核数
+         * @param keep_alive 线程空闲多长时间后退出
+         */
+        void SetOffloadAttr(int max_threads, std::chrono::milliseconds keep_alive = std::chrono::seconds(10)){
+            m_offload_pool.SetAttr(max_threads, 0, keep_alive);
+        }
+
+        /**
+         * @brief 获得当前协程的一个引用，并记录当前协程所在的协程池和线程，用于实现协程级的同步原语
+         * @return 持有一个引用的协程指针，之后由Wake()转移该引用。当前不是协程池中的协程时返回nullptr
+         * @note 调用者将返回的协程加入等待队列后调用Fiber::Block()。即使Wake()在Block()之前被调用，
+         *       协程也只会在让出CPU之后才被恢复执行
+         */
+        static Fiber* PrepareBlock();
+
+        /**
+         * @brief 唤醒通过PrepareBlock()获得的协程，协程被放入其阻塞时所在线程的任务队列
+         * @note 可以由任意线程调用
+         */
+        static void Wake(Fiber* fiber);
+
         /**
          * 获得当前线程Id，该方法只能由协程池中的线程调用
          * @return 线程Id
@@ -100,16 +255,59 @@ namespace MyRPC{
         // 协程池主循环
         int MainLoop(int thread_id);
 
-        // 当有新的任务到来时，可以通过event_fd来唤醒协程池中的所有主协程
-        int m_global_event_fd;
+        // 将当前线程绑定在m_cpu_affinity中对应的CPU上
+        void bind_cpu(int thread_id);
+
+        // 恢复任务队列中的协程执行，并根据执行后的状态重新入队或释放
+        void run_task(EventManager* context_ptr, Fiber* tsk_ptr);
+
+        // 从其他线程的任务队列中窃取协程，放入线程thread_id的任务队列
+        bool steal(int thread_id);
+
+        // 当前线程有协程积压且存在空闲线程时，将本地队列中一半未绑定线程的协程发布到可窃取队列，并唤醒一个空闲的线程
+        void publish_tasks(int thread_id);
+
+        // 唤醒一个空闲的线程
+        void wake_idle_thread(int thread_id);
+
+        // 若线程thread_id正在休眠，则唤醒该线程，返回是否进行了唤醒
+        bool wakeup(int thread_id);
+
+        // 线程空闲时自旋等待新的协程或IO事件，等到时返回true
+        bool spin(int thread_id);
+
+        // 根据自旋的结果或休眠的时长调整线程的自旋时长
+        void adjust_spin(EventManager* context_ptr, bool grow);
+
+        // 在线程池pool中执行func，当前协程阻塞直到func执行完成。无法转移执行时返回false
+        bool run_offloaded(OffloadPool& pool, std::function<void()> func);
 
         // 判断协程池是否有线程在运行
         std::atomic<bool> m_running {false};
 
+        std::atomic<int> m_started_threads {0}; // 已经创建了事件管理器的线程数量
+
         // 用以强制关闭协程池
         std::atomic<bool> m_stopping{false};
 
         std::atomic<int> m_tasks_cnt {0}; // 当前任务数量
+
+        bool m_work_stealing = false; // 是否开启工作窃取
+        std::atomic<int> m_idle_threads {0}; // 休眠（等待epoll事件）的线程数量
+
+        size_t m_stack_size = 0; // 协程栈的默认大小，0表示使用Fiber::DEFAULT_STACK_SIZE
+        StackPool::StackType m_stack_type = StackPool::MALLOC_STACK; // 协程栈的默认分配方式
+
+        EventManager::IOBackend m_io_backend; // 被hook的IO函数使用的后端
+
+        std::vector<int> m_cpu_affinity; // 线程绑定的CPU列表，为空表示不绑定
+
+        IdlePolicy m_idle_policy = PARK; // 线程空闲时的等待策略
+        useconds_t m_max_spin_us = DEFAULT_MAX_SPIN_US; // 自旋时长的上限
+
+        static const int BLOCKING_IO_THREADS = 4; // 阻塞IO线程池的线程数量
+        OffloadPool m_blocking_io_pool{BLOCKING_IO_THREADS}; // 执行普通文件读写等阻塞操作的线程池
+        OffloadPool m_offload_pool{(int)std::max(1u, std::thread::hardware_concurrency())}; // Offload()使用的工作线程池
     };
 
 }
@@ -2,9 +2,9 @@
 #define MYRPC_FIBER_SYNC_H
 
 #include <atomic>
+#include <mutex>
 #include <unistd.h>
-#include <set>
-#include <queue>
+#include <sched.h>
 
 #include "noncopyable.h"
 #include "macro.h"
@@ -20,10 +20,21 @@ namespace MyRPC{
     namespace FiberSync {
         /**
          * @brief 协程级互斥锁
+         * @note 获得锁失败的协程加入等待队列并阻塞（不占用任务队列），unlock时只唤醒一个等待的协程，将其放回阻塞时所在线程的任务队列。
+         *       不在协程池中的线程获得锁失败时让出CPU并重试
          */
         class Mutex : public NonCopyable {
         public:
-            Mutex();
+            enum Mode{
+                BARGING = 0, // unlock时释放锁并唤醒一个等待的协程，被唤醒的协程需要重新竞争锁，新到达的协程可以插队。吞吐量较高
+                HANDOFF = 1  // unlock时直接将锁交给等待时间最长的协程，新到达的协程不能插队。严格按照先来先服务的顺序获得锁
+            };
+
+            /**
+             * @param mode 锁的交接方式
+             * @param spin_count 阻塞之前自旋尝试获得锁的次数。锁的持有时间很短且持有者在其他线程上运行时，自旋可以避免阻塞和唤醒的开销
+             */
+            explicit Mutex(Mode mode = BARGING, int spin_count = 0);
             ~Mutex();
 
             void lock();
@@ -31,112 +42,214 @@ namespace MyRPC{
             void unlock();
 
             bool tryLock() {
-                return !m_lock.test_and_set(std::memory_order_acquire);
+                return !m_lock.test_and_set(std::memory_order_seq_cst);
             }
 
+            Mode GetMode() const{return m_mode;}
+
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_LOCK_LEVEL
             int64_t _debug_lock_owner = -10; // 锁持有者的Fiber id
 #endif
         private:
             std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
 
-            std::atomic<int64_t> m_lock_id = {0};
+            Mode m_mode;
+            int m_spin_count;
 
             int m_mutex_id;
-            std::queue<std::pair<int64_t, int>> m_wait_queue; // FiberID ThreadID
+
+            // 等待队列，阻塞的协程不在任何任务队列中，因此通过TaskQueueNode串联，不需要额外分配内存。
+            // 队列中的每个Fiber*持有协程的一个引用
+            LocalTaskQueue<Fiber> m_wait_queue;
             SpinLock m_wait_queue_lock;
+            // 正在等待或即将加入等待队列的协程数量，没有等待者时unlock不需要获得m_wait_queue_lock
+            std::atomic<int> m_waiters = {0};
+
+            // 阻塞当前协程直到被unlock唤醒，HANDOFF模式下返回时已经获得了锁。返回false表示获得了锁且没有阻塞
+            bool wait();
         };
 
-        /*
-         * @brief 协程级读写锁
+        /**
+         * @brief 协程级读写锁，偏向读者（BRAVO: Biased Locking for Reader-Writer Locks）
+         * @note 偏向读者时，读者只需要在全局的读者表中占用一个槽位（按锁的地址和协程id散列），不修改锁本身的任何状态，
+         *       因此读者之间没有共享的缓存行。写者获得锁后撤销偏向，等待读者表中属于该锁的槽位全部释放；
+         *       撤销之后的一段时间内（撤销耗时的INHIBIT_MULTIPLIER倍）读者走普通路径，避免读写混合时频繁撤销。
+         *       普通路径是写者优先的读写锁，等待的协程阻塞，由释放锁的一方直接交出锁并唤醒
          */
-        class RWMutex{
+        class RWMutex : public NonCopyable{
         public:
-            void lock() {
-                write_lock.lock();
-            }
-            void unlock() {
-                write_lock.unlock();
-            }
+            RWMutex() = default;
+            ~RWMutex();
 
-            void lock_shared(){
-                //read_lock.lock();
-                while(!read_lock.tryLock()){
-                    if(reader_blocked){ // 如果存在写操作，则阻塞直到获得读锁
-                        read_lock.lock();
-                        break;
-                    } // 如果不存在写操作，则以自旋锁的方式获得读锁
-                }
-                if(++m_reader == 1){
-                    // 存在线程读操作时，写加锁
-                    if(!write_lock.tryLock()) {
-                        reader_blocked = true;
-                        write_lock.lock();
-                        reader_blocked = false;
-                    }
-                }
-                read_lock.unlock();
-            }
+            void lock();
+            void unlock();
+
+            void lock_shared();
+            void unlock_shared();
 
-            void unlock_shared(){
-                //read_lock.lock();
-                while(!read_lock.tryLock()); // 以自旋锁的方式获得读锁
-                if(--m_reader == 0){
-                    write_lock.unlock(); // 没有线程读操作时，释放写锁
-                }
-                read_lock.unlock();
-            }
         private:
-            Mutex write_lock;
-            Mutex read_lock;
+            static const int READER_TABLE_BITS = 12;
+            static const int READER_TABLE_SIZE = 1 << READER_TABLE_BITS; // 全局读者表的大小
+            static const int INHIBIT_MULTIPLIER = 9;
 
-            int m_reader = 0;
+            // 读者表中的槽位，m_lock不为空表示有读者通过偏向路径持有该锁，m_owner为持有者的id
+            struct ReaderSlot{
+                std::atomic<RWMutex*> m_lock {nullptr};
+                std::atomic<int64_t> m_owner {0};
+            };
+            static ReaderSlot s_reader_table[READER_TABLE_SIZE];
 
-            std::atomic<bool> reader_blocked = {false};
-        };
+            std::atomic<bool> m_reader_bias {false}; // 读者是否可以走偏向路径
+            std::atomic<int64_t> m_inhibit_until {0}; // 在此之前（steady_clock，纳秒）不重新开启偏向
+
+            // 普通路径的读写锁状态，由m_state_lock保护
+            SpinLock m_state_lock;
+            int m_readers = 0;
+            bool m_writer = false;
+            // 等待的协程，队列中的每个Fiber*持有协程的一个引用
+            LocalTaskQueue<Fiber> m_read_waiters;
+            LocalTaskQueue<Fiber> m_write_waiters;
+
+            // 当前读者的id：协程中为协程id，协程外为线程唯一的负数
+            static int64_t reader_id();
+
+            ReaderSlot& get_slot(int64_t id);
 
-        // TODO: Semaphore ConditionVariable
+            void lock_shared_slow();
+            void unlock_shared_slow();
 
+            // 撤销读者偏向，等待通过偏向路径持有锁的读者全部释放
+            void revoke_bias();
+        };
+
+        /**
+         * @brief 协程级条件变量
+         * @note 等待的协程加入等待队列并阻塞，notify_one只唤醒一个等待的协程，notify_all唤醒所有等待的协程。
+         *       不在协程池中的线程调用wait时让出CPU后立即返回（虚假唤醒），因此调用者需要在循环中检查条件
+         * @tparam MutexType 锁的类型，需要提供lock()和unlock()
+         */
         template <class MutexType>
         class ConditionVariable : public NonCopyable{
         public:
-            void wait(MutexType& mutex) {
-                m_wait_queue_lock.lock();
-                m_wait_queue.push(std::make_pair(Fiber::GetCurrentId(), FiberPool::GetCurrentThreadId()));
+            ~ConditionVariable(){
+                if(!m_wait_queue.Empty()) Logger::warn("ConditionVariable is destroyed with waiting fibers");
+            }
 
-                do{
-                    m_wait_queue_lock.unlock();
+            /**
+             * @brief 释放锁并阻塞当前协程，被唤醒后重新获得锁
+             * @param mutex 调用者持有的锁
+             */
+            void wait(MutexType& mutex) {
+                auto fiber = FiberPool::PrepareBlock();
+                if(fiber == nullptr){
+                    // 不在协程池中，无法阻塞
                     mutex.unlock();
-                    Fiber::Suspend();
+                    sched_yield();
                     mutex.lock();
-                    m_wait_queue_lock.lock();
-                }while((m_wait_queue.front().first != Fiber::GetCurrentId()) && (!m_notify_all));
-
-                m_wait_queue.pop();
-                if(m_notify_all && m_wait_queue.empty()){
-                    m_notify_all = false;
+                    return;
                 }
-                m_wait_queue_lock.unlock();
+                {
+                    // 先加入等待队列再释放锁，释放锁之后的notify一定能看到当前协程
+                    std::lock_guard<SpinLock> lock(m_wait_queue_lock);
+                    m_wait_queue.Push(fiber);
+                }
+                mutex.unlock();
+                Fiber::Block();
+                mutex.lock();
+            }
+
+            /**
+             * @brief 阻塞当前协程直到pred()为true
+             */
+            template<class Predicate>
+            void wait(MutexType& mutex, Predicate pred) {
+                while(!pred()) wait(mutex);
             }
+
             void notify_one(){
-                m_wait_queue_lock.lock();
-                if(!m_wait_queue.empty()) {
-                    FiberPool::GetThis()->Notify(m_wait_queue.front().second);
+                Fiber* fiber = nullptr;
+                {
+                    std::lock_guard<SpinLock> lock(m_wait_queue_lock);
+                    m_wait_queue.TryPop(fiber);
                 }
-                m_wait_queue_lock.unlock();
+                if(fiber) FiberPool::Wake(fiber);
             }
+
             void notify_all(){
-                //TODO Implementation
-                m_notify_all = true;
-                FiberPool::GetThis()->NotifyAll();
+                LocalTaskQueue<Fiber> to_wake;
+                Fiber* fiber;
+                {
+                    std::lock_guard<SpinLock> lock(m_wait_queue_lock);
+                    while(m_wait_queue.TryPop(fiber)) to_wake.Push(fiber);
+                }
+                while(to_wake.TryPop(fiber)) FiberPool::Wake(fiber);
             }
 
         private:
-            std::atomic<bool> m_notify_all = {false};
-
-            std::queue<std::pair<int64_t, int>> m_wait_queue; // FiberID ThreadID
+            // 等待的协程，队列中的每个Fiber*持有协程的一个引用
+            LocalTaskQueue<Fiber> m_wait_queue;
             SpinLock m_wait_queue_lock;
         };
+
+        /**
+         * @brief 协程级计数信号量
+         * @note 获取失败的协程阻塞，release时按照等待的顺序直接将计数交给等待的协程
+         */
+        class Semaphore : public NonCopyable{
+        public:
+            explicit Semaphore(int64_t count = 0): m_count(count){}
+            ~Semaphore();
+
+            void acquire();
+            bool try_acquire();
+
+            /**
+             * @brief 增加计数，唤醒至多n个等待的协程
+             */
+            void release(int64_t n = 1);
+
+        private:
+            SpinLock m_lock;
+            int64_t m_count;
+            LocalTaskQueue<Fiber> m_wait_queue;
+        };
+
+        /**
+         * @brief 协程级一次性门闩，计数减到0时唤醒所有等待的协程，之后wait立即返回
+         */
+        class Latch : public NonCopyable{
+        public:
+            explicit Latch(int64_t count): m_count(count){}
+            ~Latch();
+
+            void count_down(int64_t n = 1);
+            bool try_wait();
+            void wait();
+            void arrive_and_wait(int64_t n = 1);
+
+        private:
+            SpinLock m_lock;
+            int64_t m_count;
+            LocalTaskQueue<Fiber> m_wait_queue;
+        };
+
+        /**
+         * @brief 等待一组子协程结束：启动子协程前调用Add，子协程结束时调用Done，Wait阻塞直到计数为0
+         * @note 与Latch不同，计数为0之后可以再次调用Add重复使用
+         */
+        class WaitGroup : public NonCopyable{
+        public:
+            ~WaitGroup();
+
+            void Add(int64_t delta = 1);
+            void Done(){ Add(-1); }
+            void Wait();
+
+        private:
+            SpinLock m_lock;
+            int64_t m_count = 0;
+            LocalTaskQueue<Fiber> m_wait_queue;
+        };
     }
 }
 
@@ -0,0 +1,95 @@
+#ifndef MYRPC_IO_URING_H
+#define MYRPC_IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+#include "noncopyable.h"
+
+namespace MyRPC{
+    /**
+     * @brief io_uring的简单封装，直接通过系统调用和共享内存访问提交队列（SQ）和完成队列（CQ），不依赖liburing
+     * @note 不是线程安全的，只能由一个线程访问
+     */
+    class IOUring: public NonCopyable{
+    public:
+        IOUring() = default;
+        ~IOUring();
+
+        /**
+         * @brief 创建io_uring实例
+         * @param entries 提交队列的大小
+         * @return 成功返回true。内核不支持io_uring（或被禁用）、或者不支持协程池需要的IO操作时返回false
+         */
+        bool Init(unsigned entries);
+
+        bool IsInitialized() const{ return m_ring_fd >= 0; }
+
+        /**
+         * @brief 获得io_uring实例的文件描述符，完成队列非空时该文件描述符可读
+         */
+        int GetFd() const{ return m_ring_fd; }
+
+        /**
+         * @brief 完成队列的大小
+         */
+        unsigned GetCqEntries() const{ return m_cq_entries; }
+
+        /**
+         * @brief 获取一个空闲的提交队列项，返回的项已被清零
+         * @return 提交队列已满时返回nullptr，此时需要先调用Submit()
+         */
+        io_uring_sqe* GetSqe();
+
+        /**
+         * @brief 提交队列中还没有被内核取走的项的数量
+         */
+        unsigned Pending() const;
+
+        /**
+         * @brief 将提交队列中的项提交给内核，不等待完成
+         * @return 成功提交的数量，失败返回-errno
+         */
+        int Submit();
+
+        /**
+         * @brief 从完成队列中取出一项
+         * @param user_data[out] 提交时设置的user_data
+         * @param res[out] 请求的结果，失败时为-errno
+         * @return 完成队列为空时返回false
+         */
+        bool PopCqe(uint64_t& user_data, int32_t& res);
+
+    private:
+        int m_ring_fd = -1;
+
+        void* m_sq_ring = nullptr;
+        size_t m_sq_ring_size = 0;
+        void* m_cq_ring = nullptr;
+        size_t m_cq_ring_size = 0;
+        io_uring_sqe* m_sqes = nullptr;
+        size_t m_sqes_size = 0;
+
+        // 提交队列，m_sq_head由内核修改
+        unsigned* m_sq_head = nullptr;
+        unsigned* m_sq_tail = nullptr;
+        unsigned m_sq_mask = 0;
+        unsigned m_sq_entries = 0;
+        unsigned m_sqe_tail = 0; // 已填写但还没有发布给内核的队尾
+
+        // 完成队列，m_cq_tail由内核修改
+        unsigned* m_cq_head = nullptr;
+        unsigned* m_cq_tail = nullptr;
+        unsigned m_cq_mask = 0;
+        unsigned m_cq_entries = 0;
+        io_uring_cqe* m_cqes = nullptr;
+
+        // 检查内核是否支持协程池使用的IO操作
+        bool probe_ops();
+
+        void release();
+    };
+}
+
+#endif //MYRPC_IO_URING_H
@@ -2,76 +2,191 @@
 #define MYRPC_CONCURRENT_QUEUE_H
 
 #include <atomic>
-#include "arch.h"
-#include "macro.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
 
 namespace MyRPC{
-    // Multi Producer Multi Consumer lock-free queue
+    /**
+     * @brief 有界的多生产者多消费者（MPMC）无锁队列
+     * @note 每个槽位带有一个序号（Vyukov bounded MPMC queue）：生产者和消费者各自通过CAS领取位置，
+     *       之后只访问自己领取的槽位，通过槽位的序号发布数据和归还槽位，不需要等待其他生产者提交，也没有共享的计数器。
+     *       队列可以存放QSIZE个元素，QSIZE不必是2的幂
+     * @tparam T 元素类型，需要可移动构造和移动赋值
+     * @tparam QSIZE 队列容量
+     */
     template<class T, unsigned long QSIZE>
     class MPMCLockFreeQueue{
+        static_assert(QSIZE > 0, "MPMCLockFreeQueue requires a positive size");
     public:
-        bool TryPush(T data){
-            unsigned long current_write, current_read;
+        MPMCLockFreeQueue(){
+            for(unsigned long i = 0; i < QSIZE; i++) m_array[i].m_seq.store(2 * i, std::memory_order_relaxed);
+        }
 
-            // m_write_idx原子加一
-            current_write = m_write_idx;
-            do{
-                current_read = m_read_idx;
+        ~MPMCLockFreeQueue(){
+            // 析构队列中剩余的元素
+            size_t pos = m_read_idx.load(std::memory_order_relaxed);
+            while(m_array[pos % QSIZE].m_seq.load(std::memory_order_relaxed) == 2 * pos + 1){
+                m_array[pos % QSIZE].get()->~T();
+                ++pos;
+            }
+        }
 
-                if(((current_write + 1) % QSIZE) == (current_read % QSIZE)){ // FULL
-                    return false;
+        MPMCLockFreeQueue(const MPMCLockFreeQueue&) = delete;
+        MPMCLockFreeQueue& operator=(const MPMCLockFreeQueue&) = delete;
+
+        /**
+         * @brief 入队
+         * @return 队列已满时返回false，此时data不会被移走
+         */
+        template<class U>
+        bool TryPush(U&& data){
+            size_t pos = m_write_idx.load(std::memory_order_relaxed);
+            Cell* cell;
+            while(true){
+                cell = &m_array[pos % QSIZE];
+                size_t seq = cell->m_seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(2 * pos);
+                if(diff == 0){
+                    if(m_write_idx.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }else if(diff < 0){
+                    return false; // FULL
+                }else{
+                    pos = m_write_idx.load(std::memory_order_relaxed); // 其他生产者已经领取了该位置
                 }
-            }while(!m_write_idx.compare_exchange_weak(current_write, current_write + 1));
-
-            // 写入data数据
-            m_array[current_write % QSIZE] = data;
-
-            // commit操作: 更新m_commit_write_idx
-            while(!m_commit_write_idx.compare_exchange_weak(current_write, current_write + 1)){
-                MYRPC_PAUSE;
             }
-
-            ++m_count;
+            new (cell->m_storage) T(std::forward<U>(data));
+            cell->m_seq.store(2 * pos + 1, std::memory_order_release);
             return true;
         }
 
+        /**
+         * @brief 出队
+         * @return 队列为空时返回false
+         */
         bool TryPop(T& data){
-            unsigned long current_commit_write, current_read;
-
-            current_read = m_read_idx;
-            do{
-                current_commit_write = m_commit_write_idx;
-
-                if((current_read % QSIZE) == (current_commit_write % QSIZE)){ // EMPTY
-                    return false;
+            size_t pos = m_read_idx.load(std::memory_order_relaxed);
+            Cell* cell;
+            while(true){
+                cell = &m_array[pos % QSIZE];
+                size_t seq = cell->m_seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(2 * pos + 1);
+                if(diff == 0){
+                    if(m_read_idx.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                }else if(diff < 0){
+                    return false; // EMPTY
+                }else{
+                    pos = m_read_idx.load(std::memory_order_relaxed);
                 }
+            }
+            pop_cell(cell, pos, data);
+            return true;
+        }
 
-                data = m_array[current_read % QSIZE];
+        /**
+         * @brief 批量入队，一次CAS领取多个连续的位置
+         * @param data 待入队的元素，前（返回值）个元素被移走
+         * @return 实际入队的元素数量，队列已满时为0
+         */
+        size_t TryPushBatch(T* data, size_t n){
+            size_t pos = m_write_idx.load(std::memory_order_relaxed);
+            size_t k;
+            while(true){
+                // 从pos开始数出连续的空闲槽位。消费者不会让空闲的槽位重新被占用，因此领取成功后这些槽位一定可以写入
+                k = 0;
+                while(k < n && k < QSIZE &&
+                      m_array[(pos + k) % QSIZE].m_seq.load(std::memory_order_acquire) == 2 * (pos + k)) ++k;
+                if(k == 0){
+                    intptr_t diff = (intptr_t)m_array[pos % QSIZE].m_seq.load(std::memory_order_acquire) - (intptr_t)(2 * pos);
+                    if(diff < 0) return 0; // FULL
+                    pos = m_write_idx.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if(m_write_idx.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) break;
+            }
+            for(size_t i = 0; i < k; i++){
+                auto cell = &m_array[(pos + i) % QSIZE];
+                new (cell->m_storage) T(std::move(data[i]));
+                cell->m_seq.store(2 * (pos + i) + 1, std::memory_order_release);
+            }
+            return k;
+        }
 
-                if(m_read_idx.compare_exchange_weak(current_read, current_read + 1)){
-                    --m_count;
-                    return true;
+        /**
+         * @brief 批量出队，一次CAS领取多个连续的元素
+         * @param data 至少可以存放n个元素的数组
+         * @return 实际出队的元素数量，队列为空时为0
+         */
+        size_t TryPopBatch(T* data, size_t n){
+            size_t pos = m_read_idx.load(std::memory_order_relaxed);
+            size_t k;
+            while(true){
+                k = 0;
+                while(k < n && k < QSIZE &&
+                      m_array[(pos + k) % QSIZE].m_seq.load(std::memory_order_acquire) == 2 * (pos + k) + 1) ++k;
+                if(k == 0){
+                    intptr_t diff = (intptr_t)m_array[pos % QSIZE].m_seq.load(std::memory_order_acquire) - (intptr_t)(2 * pos + 1);
+                    if(diff < 0) return 0; // EMPTY
+                    pos = m_read_idx.load(std::memory_order_relaxed);
+                    continue;
                 }
-            }while(true);
+                if(m_read_idx.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) break;
+            }
+            for(size_t i = 0; i < k; i++) pop_cell(&m_array[(pos + i) % QSIZE], pos + i, data[i]);
+            return k;
+        }
+
+        /**
+         * @brief 队列中元素数量的近似值，有并发操作时仅供参考
+         */
+        unsigned long Size() const{
+            size_t read = m_read_idx.load(std::memory_order_acquire);
+            size_t write = m_write_idx.load(std::memory_order_acquire);
+            return write > read ? (write - read < QSIZE ? write - read : QSIZE) : 0;
+        }
 
-            MYRPC_ASSERT(false);
-            return false;
+        bool Empty() const{
+            return Size() == 0;
         }
 
-        unsigned long Size(){
-            return m_count;
+        /**
+         * @brief 下一个入队位置的槽位是否空闲（下一次TryPush是否可能成功）
+         */
+        bool CanPush() const{
+            size_t pos = m_write_idx.load(std::memory_order_acquire);
+            return m_array[pos % QSIZE].m_seq.load(std::memory_order_acquire) == 2 * pos;
         }
 
-        bool Empty() {
-            return m_count == 0;
+        /**
+         * @brief 下一个出队位置的元素是否已经发布（下一次TryPop是否可能成功）
+         */
+        bool CanPop() const{
+            size_t pos = m_read_idx.load(std::memory_order_acquire);
+            return m_array[pos % QSIZE].m_seq.load(std::memory_order_acquire) == 2 * pos + 1;
         }
+
     private:
-        std::atomic<T> m_array[QSIZE];
-        std::atomic<unsigned long> m_commit_write_idx = {0};
-        std::atomic<unsigned long> m_write_idx = {0};
-        std::atomic<unsigned long> m_read_idx = {0};
+        // 槽位的序号等于2 * pos时可以写入第pos个元素，等于2 * pos + 1时可以读出第pos个元素。
+        // 序号取位置的两倍，使得QSIZE为1时“可以读出第pos个元素”和“可以写入第pos + 1个元素”仍然可以区分
+        struct Cell{
+            std::atomic<size_t> m_seq;
+            alignas(T) unsigned char m_storage[sizeof(T)];
+
+            T* get(){ return std::launder(reinterpret_cast<T*>(m_storage)); }
+        };
+
+        void pop_cell(Cell* cell, size_t pos, T& data){
+            auto item = cell->get();
+            data = std::move(*item);
+            item->~T();
+            cell->m_seq.store(2 * (pos + QSIZE), std::memory_order_release); // 归还槽位，供第pos + QSIZE个元素使用
+        }
 
-        std::atomic<unsigned long> m_count;
+        // 生产者和消费者的位置分别位于独立的缓存行，避免互相干扰
+        alignas(64) std::atomic<size_t> m_write_idx = {0};
+        alignas(64) std::atomic<size_t> m_read_idx = {0};
+        alignas(64) Cell m_array[QSIZE];
     };
 }
 
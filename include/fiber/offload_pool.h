@@ -0,0 +1,75 @@
+#ifndef MYRPC_OFFLOAD_POOL_H
+#define MYRPC_OFFLOAD_POOL_H
+
+#include <deque>
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+
+#include "noncopyable.h"
+
+namespace MyRPC{
+    /**
+     * @brief 执行阻塞操作或耗时计算的弹性线程池，与协程池的线程分开，这些操作不会影响协程池中其他协程的执行
+     * @note 提交任务时如果没有空闲的线程，则创建新线程，直到线程数量达到上限；超过核心线程数量的线程空闲一段时间后退出
+     */
+    class OffloadPool: public NonCopyable{
+    public:
+        using Task = std::function<void()>;
+
+        /**
+         * @param max_threads[in] 线程数量的上限
+         * @param core_threads[in] 核心线程数量，核心线程创建后不会因为空闲而退出
+         * @param keep_alive[in] 非核心线程空闲多长时间后退出
+         */
+        explicit OffloadPool(int max_threads, int core_threads = 0,
+                             std::chrono::milliseconds keep_alive = std::chrono::seconds(10));
+        ~OffloadPool();
+
+        /**
+         * @brief 提交任务，由线程池中的任意一个线程执行
+         * @note 任务不能抛出异常
+         */
+        void Submit(Task&& task);
+
+        /**
+         * @brief 执行完已提交的任务后停止所有线程，之后仍然可以提交任务（会重新创建线程）
+         */
+        void Stop();
+
+        /**
+         * @brief 修改线程池的参数，已经创建的线程在空闲超时后按新的参数退出
+         */
+        void SetAttr(int max_threads, int core_threads, std::chrono::milliseconds keep_alive);
+
+        /**
+         * @brief 获得当前的线程数量
+         */
+        int GetThreadsNum();
+
+    private:
+        int m_max_threads;
+        int m_core_threads;
+        std::chrono::milliseconds m_keep_alive;
+
+        std::list<std::thread> m_threads;
+        std::vector<std::thread> m_exited_threads; // 因空闲而退出、还没有被join的线程
+        int m_idle_threads = 0; // 正在等待任务的线程数量
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<Task> m_tasks;
+        bool m_stopping = false;
+
+        void worker(std::list<std::thread>::iterator self);
+
+        // 取出已经退出的线程，由调用者在释放m_mutex之后join，必须在持有m_mutex时调用
+        std::vector<std::thread> take_exited_threads();
+    };
+}
+
+#endif //MYRPC_OFFLOAD_POOL_H
@@ -0,0 +1,128 @@
+#ifndef MYRPC_STACK_POOL_H
+#define MYRPC_STACK_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.h"
+
+namespace MyRPC{
+    /**
+     * @brief 协程栈内存池，每个线程拥有一个实例
+     * @note 协程栈按大小分级（MIN_STACK_SIZE的2的幂次倍），每一级维护一个空闲链表。
+     *       释放的协程栈优先放回当前线程的空闲链表，超过高水位线时才真正释放内存。
+     */
+    class StackPool: public NonCopyable{
+    public:
+        static const size_t MIN_STACK_SIZE = 4096; // 最小的栈大小分级
+        static const int SIZE_CLASS_NUM = 12; // 栈大小分级数量：4KB, 8KB, ..., 8MB
+        static const size_t DEFAULT_HIGH_WATER_MARK = 128; // 每一级默认最多缓存的协程栈数量
+
+        static const size_t MMAP_TRIM_THRESHOLD = 65536; // 归还大于该大小的mmap协程栈时，释放其已使用的物理页
+        static const size_t MMAP_TRIM_KEEP = 16384; // 释放物理页时，保留栈顶的这部分空间
+
+        static const size_t GROWABLE_STACK_RESERVE = 1024 * 1024; // 可增长协程栈预留的虚拟地址空间大小（包括保护页）
+
+        /**
+         * @note 每个MMAP_STACK/GROWABLE_STACK协程栈占用两个内存映射区域（VMA），
+         *       大量协程时可能需要调大vm.max_map_count
+         */
+        enum StackType{
+            MALLOC_STACK = 0, // 由aligned_alloc分配
+            MMAP_STACK = 1, // 由mmap分配，栈底（低地址）有一个PROT_NONE的保护页，物理内存在访问时才分配
+            GROWABLE_STACK = 2, // 预留GROWABLE_STACK_RESERVE大小的虚拟地址空间，只有栈顶部分可以访问，可以原地扩充
+            SHARED_STACK = 3, // 同一线程的协程共享一个大栈，切换时保存已使用的部分。由Fiber管理，不能通过Alloc分配
+            STACK_TYPE_NUM
+        };
+
+        struct Statistics{
+            uint64_t alloc_count = 0; // 分配次数
+            uint64_t free_count = 0; // 释放次数
+            uint64_t hit_count = 0; // 从空闲链表中分配的次数
+            uint64_t miss_count = 0; // 向系统申请内存的次数
+            size_t cached_count = 0; // 当前缓存的协程栈数量
+            size_t cached_bytes = 0; // 当前缓存的协程栈总大小
+        };
+
+        ~StackPool();
+
+        /**
+         * @brief 获得当前线程的协程栈内存池
+         * @return 若当前线程的内存池已析构（线程退出阶段），返回nullptr
+         */
+        static StackPool* GetThis();
+
+        /**
+         * @brief 从当前线程的内存池分配协程栈
+         * @param size[in,out] 需要的栈大小，返回时被修改为实际分配的栈大小
+         * @param type 协程栈的分配方式
+         * @return 栈空间的起始地址（低地址，不包括保护页），失败返回nullptr
+         */
+        static void* Alloc(size_t& size, StackType type = MALLOC_STACK);
+
+        /**
+         * @brief 将协程栈归还给当前线程的内存池
+         * @param stack 栈空间的起始地址，必须由Alloc分配
+         * @param size 栈大小，必须为Alloc返回的实际栈大小
+         * @param type 协程栈的分配方式，必须与Alloc时相同
+         */
+        static void Free(void* stack, size_t size, StackType type = MALLOC_STACK);
+
+        /**
+         * @brief 原地调整GROWABLE_STACK协程栈可访问部分的大小（栈顶地址不变）
+         * @param stack[in,out] 栈空间的起始地址，返回时被修改为调整后的起始地址
+         * @param size[in,out] 栈大小，返回时被修改为调整后的栈大小
+         * @param new_size 新的栈大小，会被向上对齐到内存页大小
+         * @return 成功返回true；超出预留空间或系统调用失败时返回false，此时stack和size不变
+         * @note 扩充协程栈的过程是异步信号安全的，可以在SIGSEGV信号处理函数中调用
+         */
+        static bool Resize(void*& stack, size_t& size, size_t new_size);
+
+        /**
+         * @brief 获得系统内存页大小
+         */
+        static size_t GetPageSize();
+
+        /**
+         * @brief 设置每一级空闲链表最多缓存的协程栈数量（所有线程共享该设置）
+         */
+        static void SetHighWaterMark(size_t n){ s_high_water_mark = n; }
+        static size_t GetHighWaterMark(){ return s_high_water_mark; }
+
+        /**
+         * @brief 获得当前线程内存池的统计信息
+         */
+        static Statistics GetStatistics();
+
+        /**
+         * @brief 释放当前线程内存池中缓存的所有协程栈
+         */
+        static void Shrink();
+
+    private:
+        struct FreeNode{
+            FreeNode* next;
+        };
+
+        FreeNode* m_free_list[STACK_TYPE_NUM][SIZE_CLASS_NUM] = {{nullptr}};
+        size_t m_free_count[STACK_TYPE_NUM][SIZE_CLASS_NUM] = {{0}};
+
+        Statistics m_stat;
+
+        inline static std::atomic<size_t> s_high_water_mark = {DEFAULT_HIGH_WATER_MARK};
+
+        void* allocate(size_t& size, StackType type);
+        void deallocate(void* stack, size_t size, StackType type);
+        void shrink();
+
+        // 根据栈大小计算分级，若超出最大分级则返回-1
+        static int size_class(size_t size);
+
+        // 向系统申请/释放协程栈
+        static void* sys_alloc(size_t& size, StackType type);
+        static void sys_free(void* stack, size_t size, StackType type);
+    };
+}
+
+#endif //MYRPC_STACK_POOL_H
@@ -0,0 +1,126 @@
+#ifndef MYRPC_TASK_H
+#define MYRPC_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MyRPC{
+    /**
+     * @brief 只能移动的可调用对象包装器，用于保存协程中运行的函数
+     * @note 不超过INLINE_SIZE字节的可调用对象直接保存在Task内部，不需要分配内存。
+     *       INLINE_SIZE足以容纳RPCClient::InvokeAsync、TCPServer::handleConnection等创建协程时使用的lambda
+     */
+    class Task{
+    public:
+        static const size_t INLINE_SIZE = 112; // 内联缓冲区大小，sizeof(Task) == 128
+
+        Task() noexcept = default;
+        Task(std::nullptr_t) noexcept {}
+
+        template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task> &&
+                                                   std::is_invocable_v<std::decay_t<F>&>>>
+        Task(F&& func){
+            using Callable = std::decay_t<F>;
+            // 函数引用退化成的函数指针不可能为空，只检查本身就是指针的参数
+            if constexpr (std::is_pointer_v<std::remove_reference_t<F>>){
+                if(!func) return;
+            }
+            if constexpr (is_inline<Callable>()){
+                new (m_storage) Callable(std::forward<F>(func));
+                m_ops = &inline_ops<Callable>;
+            }else{
+                // 超出内联缓冲区的可调用对象保存在堆上，缓冲区中只保存指针
+                *reinterpret_cast<Callable**>(m_storage) = new Callable(std::forward<F>(func));
+                m_ops = &heap_ops<Callable>;
+            }
+        }
+
+        Task(Task&& rhs) noexcept{
+            move_from(rhs);
+        }
+
+        Task& operator=(Task&& rhs) noexcept{
+            if(this != &rhs){
+                reset();
+                move_from(rhs);
+            }
+            return *this;
+        }
+
+        Task& operator=(std::nullptr_t) noexcept{
+            reset();
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task(){
+            reset();
+        }
+
+        /**
+         * @brief 调用保存的函数，Task必须非空
+         */
+        void operator()(){
+            m_ops->invoke(m_storage);
+        }
+
+        explicit operator bool() const noexcept{ return m_ops != nullptr; }
+
+        /**
+         * @brief 销毁保存的函数
+         */
+        void reset() noexcept{
+            if(m_ops){
+                m_ops->destroy(m_storage);
+                m_ops = nullptr;
+            }
+        }
+
+    private:
+        struct Ops{
+            void (*invoke)(void* storage);
+            void (*move)(void* dst, void* src); // 将src中的可调用对象移动到dst，并销毁src中的对象
+            void (*destroy)(void* storage);
+        };
+
+        template<class Callable>
+        static constexpr bool is_inline(){
+            return sizeof(Callable) <= INLINE_SIZE && alignof(Callable) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<Callable>;
+        }
+
+        template<class Callable>
+        inline static const Ops inline_ops = {
+            [](void* storage){ (*static_cast<Callable*>(storage))(); },
+            [](void* dst, void* src){
+                new (dst) Callable(std::move(*static_cast<Callable*>(src)));
+                static_cast<Callable*>(src)->~Callable();
+            },
+            [](void* storage){ static_cast<Callable*>(storage)->~Callable(); }
+        };
+
+        template<class Callable>
+        inline static const Ops heap_ops = {
+            [](void* storage){ (**static_cast<Callable**>(storage))(); },
+            [](void* dst, void* src){ *static_cast<Callable**>(dst) = *static_cast<Callable**>(src); },
+            [](void* storage){ delete *static_cast<Callable**>(storage); }
+        };
+
+        void move_from(Task& rhs) noexcept{
+            if(rhs.m_ops){
+                rhs.m_ops->move(m_storage, rhs.m_storage);
+                m_ops = rhs.m_ops;
+                rhs.m_ops = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+        const Ops* m_ops = nullptr;
+    };
+}
+
+#endif //MYRPC_TASK_H
@@ -0,0 +1,217 @@
+#ifndef MYRPC_TASK_QUEUE_H
+#define MYRPC_TASK_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.h"
+#include "spinlock.h"
+#include "fiber/lockfree_queue.h"
+
+namespace MyRPC{
+    /**
+     * @brief 侵入式任务队列的节点，需要放入任务队列的类型（如Fiber）继承该类
+     * @note 同一时刻一个节点最多只能在一个任务队列中
+     */
+    class TaskQueueNode{
+    private:
+        std::atomic<TaskQueueNode*> m_next_task {nullptr};
+
+        template<class T> friend class LocalTaskQueue;
+        template<class T> friend class MPSCTaskQueue;
+        template<class T, unsigned long RING_SIZE> friend class TaskQueue;
+    };
+
+    /**
+     * @brief 只能由一个线程访问的FIFO任务队列，入队和出队都不需要原子操作
+     */
+    template<class T>
+    class LocalTaskQueue: public NonCopyable{
+    public:
+        void Push(T* task){
+            TaskQueueNode* node = task;
+            node->m_next_task.store(nullptr, std::memory_order_relaxed);
+            if(m_tail) m_tail->m_next_task.store(node, std::memory_order_relaxed);
+            else m_head = node;
+            m_tail = node;
+            ++m_size;
+        }
+
+        bool TryPop(T*& task){
+            if(!m_head) return false;
+            TaskQueueNode* node = m_head;
+            m_head = node->m_next_task.load(std::memory_order_relaxed);
+            if(!m_head) m_tail = nullptr;
+            --m_size;
+            task = static_cast<T*>(node);
+            return true;
+        }
+
+        size_t Size() const{ return m_size; }
+        bool Empty() const{ return m_size == 0; }
+
+    private:
+        TaskQueueNode* m_head = nullptr;
+        TaskQueueNode* m_tail = nullptr;
+        size_t m_size = 0;
+    };
+
+    /**
+     * @brief 多生产者单消费者的无锁FIFO任务队列（Vyukov侵入式MPSC队列）
+     * @note 入队只需要一次原子交换，可以由任意线程调用；出队只能由消费者线程调用
+     */
+    template<class T>
+    class MPSCTaskQueue: public NonCopyable{
+    public:
+        MPSCTaskQueue(): m_head(&m_stub), m_tail(&m_stub){}
+
+        void Push(T* task){
+            push(task);
+        }
+
+        /**
+         * @return 队列为空，或者生产者正在入队时返回false
+         */
+        bool TryPop(T*& task){
+            TaskQueueNode* tail = m_tail;
+            TaskQueueNode* next = tail->m_next_task.load(std::memory_order_acquire);
+            if(tail == &m_stub){
+                if(!next) return false;
+                m_tail = next;
+                tail = next;
+                next = next->m_next_task.load(std::memory_order_acquire);
+            }
+            if(next){
+                m_tail = next;
+                task = static_cast<T*>(tail);
+                return true;
+            }
+            if(tail != m_head.load(std::memory_order_acquire)) return false; // 生产者正在入队
+
+            // tail是队列中最后一个节点，放入stub节点后才能将其取出
+            push(&m_stub);
+            next = tail->m_next_task.load(std::memory_order_acquire);
+            if(next){
+                m_tail = next;
+                task = static_cast<T*>(tail);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief 队列是否为空，只能由消费者线程调用
+         */
+        bool Empty() const{
+            return m_tail == &m_stub && m_head.load(std::memory_order_acquire) == &m_stub;
+        }
+
+    private:
+        alignas(64) std::atomic<TaskQueueNode*> m_head; // 生产者入队的位置
+        alignas(64) TaskQueueNode* m_tail; // 消费者出队的位置
+        TaskQueueNode m_stub;
+
+        void push(TaskQueueNode* node){
+            node->m_next_task.store(nullptr, std::memory_order_relaxed);
+            auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->m_next_task.store(node, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief 多生产者多消费者的任务队列，入队操作总是成功
+     * @note 任务优先放入固定大小的无锁环形队列，环形队列满时溢出到由任务自身串联的链表中（侵入式链表，不额外分配内存）。
+     *       出队时每隔OVERFLOW_CHECK_INTERVAL次检查一次溢出链表，避免溢出的任务被饿死
+     */
+    template<class T, unsigned long RING_SIZE = 1024>
+    class TaskQueue: public NonCopyable{
+    public:
+        static const uint32_t OVERFLOW_CHECK_INTERVAL = 61;
+
+        struct Statistics{
+            uint64_t overflow_count = 0; // 溢出到链表的入队次数
+            size_t overflow_size = 0; // 当前溢出链表的长度
+            size_t overflow_peak_size = 0; // 溢出链表的最大长度
+        };
+
+        void Push(T* task){
+            if(m_ring.TryPush(task)) return;
+
+            // 环形队列已满，放入溢出链表
+            TaskQueueNode* node = task;
+            node->m_next_task.store(nullptr, std::memory_order_relaxed);
+            m_overflow_lock.lock();
+            if(m_overflow_tail) m_overflow_tail->m_next_task.store(node, std::memory_order_relaxed);
+            else m_overflow_head = node;
+            m_overflow_tail = node;
+            auto overflow_size = m_overflow_size.load(std::memory_order_relaxed) + 1;
+            m_overflow_size.store(overflow_size, std::memory_order_relaxed);
+            if(overflow_size > m_overflow_peak_size.load(std::memory_order_relaxed))
+                m_overflow_peak_size.store(overflow_size, std::memory_order_relaxed);
+            m_overflow_lock.unlock();
+
+            m_overflow_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @return 队列为空时返回false
+         */
+        bool TryPop(T*& task){
+            if(m_overflow_size.load(std::memory_order_relaxed) > 0){
+                auto tick = m_pop_tick.load(std::memory_order_relaxed) + 1;
+                m_pop_tick.store(tick, std::memory_order_relaxed);
+                if(tick % OVERFLOW_CHECK_INTERVAL == 0 && pop_overflow(task)) return true;
+            }
+            if(m_ring.TryPop(task)) return true;
+            return pop_overflow(task);
+        }
+
+        unsigned long Size(){
+            return m_ring.Size() + m_overflow_size.load(std::memory_order_relaxed);
+        }
+
+        bool Empty(){
+            return Size() == 0;
+        }
+
+        Statistics GetStatistics() const{
+            Statistics stat;
+            stat.overflow_count = m_overflow_count.load(std::memory_order_relaxed);
+            stat.overflow_size = m_overflow_size.load(std::memory_order_relaxed);
+            stat.overflow_peak_size = m_overflow_peak_size.load(std::memory_order_relaxed);
+            return stat;
+        }
+
+    private:
+        MPMCLockFreeQueue<T*, RING_SIZE> m_ring;
+
+        SpinLock m_overflow_lock;
+        TaskQueueNode* m_overflow_head = nullptr;
+        TaskQueueNode* m_overflow_tail = nullptr;
+        std::atomic<size_t> m_overflow_size {0};
+
+        std::atomic<uint32_t> m_pop_tick {0};
+
+        std::atomic<uint64_t> m_overflow_count {0};
+        std::atomic<size_t> m_overflow_peak_size {0};
+
+        bool pop_overflow(T*& task){
+            if(m_overflow_size.load(std::memory_order_relaxed) == 0) return false;
+
+            TaskQueueNode* node;
+            m_overflow_lock.lock();
+            node = m_overflow_head;
+            if(node){
+                m_overflow_head = node->m_next_task.load(std::memory_order_relaxed);
+                if(!m_overflow_head) m_overflow_tail = nullptr;
+                m_overflow_size.store(m_overflow_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            }
+            m_overflow_lock.unlock();
+            if(node) task = static_cast<T*>(node);
+            return node != nullptr;
+        }
+    };
+}
+
+#endif //MYRPC_TASK_QUEUE_H
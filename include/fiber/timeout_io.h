@@ -4,19 +4,33 @@
 #include <unistd.h>
 #include <sys/timerfd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #define MYRPC_ERR_TIMEOUT_FLAG -2
 
 /**
- * @brief 带timeout的read, accept, connect, recv函数
+ * @brief 带timeout的read, readv, writev, accept, accept4, connect, recv, recvfrom, recvmsg, send, sendto, sendmsg, sendfile函数
  * @param ts 超时时间， 单位微秒
- * @note 若超时，则返回MYRPC_ERR_TIMEOUT_FLAG。其他情况下的返回值与原系统调用相同
+ * @note 若超时，则返回MYRPC_ERR_TIMEOUT_FLAG。其他情况下的返回值与原系统调用相同。
+ *       需要完成全部字节的操作（例如send、带MSG_WAITALL的recv）在已经完成部分字节后超时，返回已完成的字节数
  */
 namespace MyRPC{
     extern ssize_t read_timeout(int fd, void *buf, size_t count, useconds_t ts);
     extern int accept_timeout(int sockfd, sockaddr *addr, socklen_t *addrlen, useconds_t ts);
     extern int connect_timeout(int sockfd, const sockaddr *addr, socklen_t addrlen, useconds_t ts);
     extern ssize_t recv_timeout(int sockfd, void *buf, size_t len, int flags, useconds_t ts);
+
+    extern ssize_t readv_timeout(int fd, const iovec *iov, int iovcnt, useconds_t ts);
+    extern ssize_t writev_timeout(int fd, const iovec *iov, int iovcnt, useconds_t ts);
+    extern int accept4_timeout(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags, useconds_t ts);
+    extern ssize_t recvfrom_timeout(int sockfd, void *buf, size_t len, int flags, sockaddr *src_addr,
+                                    socklen_t *addrlen, useconds_t ts);
+    extern ssize_t recvmsg_timeout(int sockfd, msghdr *msg, int flags, useconds_t ts);
+    extern ssize_t send_timeout(int sockfd, const void *buf, size_t len, int flags, useconds_t ts);
+    extern ssize_t sendto_timeout(int sockfd, const void *buf, size_t len, int flags, const sockaddr *dest_addr,
+                                  socklen_t addrlen, useconds_t ts);
+    extern ssize_t sendmsg_timeout(int sockfd, const msghdr *msg, int flags, useconds_t ts);
+    extern ssize_t sendfile_timeout(int out_fd, int in_fd, off_t *offset, size_t count, useconds_t ts);
 }
 
 #endif //MYRPC_TIMEOUT_IO_H
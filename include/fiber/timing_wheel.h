@@ -0,0 +1,141 @@
+#ifndef MYRPC_TIMING_WHEEL_H
+#define MYRPC_TIMING_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "noncopyable.h"
+
+namespace MyRPC{
+    class TimingWheel;
+
+    /**
+     * @brief 定时器节点基类，需要放入时间轮的对象继承该类
+     * @note 节点通过侵入式双向链表串联，同一时刻最多只在一个时间轮中
+     */
+    class TimerNode{
+    public:
+        TimerNode() = default;
+        TimerNode(const TimerNode&) {}
+        TimerNode& operator=(const TimerNode&){ return *this; }
+
+        /**
+         * @brief 节点是否在时间轮中（尚未超时且未被删除）
+         */
+        bool IsTimerActive() const{ return m_timer_next != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        TimerNode* m_timer_prev = nullptr;
+        TimerNode* m_timer_next = nullptr;
+        uint64_t m_timer_expire = 0; // 超时时刻，单位为时间轮的刻度
+    };
+
+    /**
+     * @brief 分层时间轮，插入和删除定时器的时间复杂度均为O(1)
+     * @note 第0层有LEVEL0_SIZE个槽，每个槽对应一个刻度；之后每层有LEVEL_SIZE个槽，每个槽对应上一层转一圈的时间。
+     *       时间推进到上一层转完一圈时，将下一层对应槽中的定时器重新分配到上一层（级联）。
+     *       时间轮不是线程安全的，只能由一个线程访问
+     */
+    class TimingWheel: public NonCopyable{
+    public:
+        static const uint64_t TICK_US = 1000; // 刻度大小，单位微秒
+
+        static const int LEVEL0_BITS = 8;
+        static const int LEVEL_BITS = 6;
+        static const int LEVEL_NUM = 5; // 共可表示2^32个刻度（约49天），更长的超时时间会被截断
+        static const size_t LEVEL0_SIZE = 1 << LEVEL0_BITS;
+        static const size_t LEVEL_SIZE = 1 << LEVEL_BITS;
+
+        /**
+         * @param current_tick 当前时刻
+         */
+        explicit TimingWheel(uint64_t current_tick = GetCurrentTick());
+
+        /**
+         * @brief 获得当前时刻（CLOCK_MONOTONIC），单位为刻度
+         */
+        static uint64_t GetCurrentTick();
+
+        /**
+         * @brief 计算从当前时刻起经过timeout_us微秒后的超时时刻，向上取整到刻度
+         */
+        static uint64_t GetExpireTick(uint64_t timeout_us);
+
+        /**
+         * @brief 添加定时器
+         * @param node 定时器节点，不能已经在时间轮中
+         * @param expire_tick 超时时刻，早于当前时刻时会在下一次Advance()中超时
+         */
+        void Add(TimerNode* node, uint64_t expire_tick);
+
+        /**
+         * @brief 删除定时器，若节点不在时间轮中则不做任何事
+         */
+        void Remove(TimerNode* node);
+
+        /**
+         * @brief 将时间推进到now_tick，超时的定时器被移入超时链表，之后通过PopExpired()取出
+         */
+        void Advance(uint64_t now_tick);
+
+        /**
+         * @brief 将所有定时器移入超时链表，用于销毁时间轮前取出其中的定时器
+         */
+        void ExpireAll();
+
+        /**
+         * @brief 从超时链表中取出一个定时器
+         * @return 超时链表为空时返回nullptr
+         */
+        TimerNode* PopExpired();
+
+        /**
+         * @brief 获得从now_tick起到下一个定时器可能超时的刻度数，用于计算epoll_wait的超时时间
+         * @return 没有定时器时返回-1
+         * @note 返回值可能早于实际的超时时刻（例如需要级联时，或者槽中的定时器已被删除），但不会晚于实际的超时时刻
+         */
+        int64_t NextTimeout(uint64_t now_tick) const;
+
+        /**
+         * @brief 时间轮中（包括超时链表中）的定时器数量
+         */
+        size_t Size() const{ return m_count; }
+        bool Empty() const{ return m_count == 0; }
+
+    private:
+        static const uint64_t LEVEL0_MASK = LEVEL0_SIZE - 1;
+        static const uint64_t LEVEL_MASK = LEVEL_SIZE - 1;
+        static const uint64_t MAX_TIMEOUT_TICK = (1ULL << (LEVEL0_BITS + (LEVEL_NUM - 1) * LEVEL_BITS)) - 1;
+
+        // 每个槽是一个以哨兵节点为头的双向循环链表
+        TimerNode m_level0[LEVEL0_SIZE];
+        TimerNode m_levels[LEVEL_NUM - 1][LEVEL_SIZE];
+        TimerNode m_expired;
+
+        // 第0层中非空槽的位图。删除定时器时不清除对应位，只在推进到该槽时清除
+        uint64_t m_level0_bitmap[LEVEL0_SIZE / 64] = {0};
+
+        uint64_t m_current; // 下一个需要处理的刻度，之前的刻度都已处理完毕
+        size_t m_count = 0;
+
+        // 根据超时时刻将节点放入对应的槽中
+        void insert(TimerNode* node);
+
+        // 第0层转完一圈时，将上层对应槽中的定时器重新分配
+        void cascade();
+
+        // 在第0层中查找下标不小于idx的第一个可能非空的槽，找不到时返回LEVEL0_SIZE
+        size_t find_level0_slot(size_t idx) const;
+
+        static void list_init(TimerNode* head){ head->m_timer_prev = head->m_timer_next = head; }
+        static bool list_empty(const TimerNode* head){ return head->m_timer_next == head; }
+        static void list_push_back(TimerNode* head, TimerNode* node);
+        static void list_unlink(TimerNode* node);
+        // 将from中的所有节点移到to的尾部
+        static void list_splice(TimerNode* from, TimerNode* to);
+    };
+}
+
+#endif //MYRPC_TIMING_WHEEL_H
@@ -0,0 +1,126 @@
+#ifndef MYRPC_INTRUSIVE_PTR_H
+#define MYRPC_INTRUSIVE_PTR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace MyRPC{
+    /**
+     * @brief 侵入式引用计数基类，引用计数保存在对象内部
+     * @note 与std::shared_ptr相比，不需要额外分配控制块，且可以通过AddRef()/Release()以裸指针的形式传递所有权
+     */
+    template<class T>
+    class RefCounted{
+    public:
+        RefCounted() = default;
+        RefCounted(const RefCounted&): m_ref_count(0){}
+        RefCounted& operator=(const RefCounted&){ return *this; }
+
+        /**
+         * @brief 增加一个引用
+         */
+        void AddRef() const{
+            m_ref_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 释放一个引用，引用计数降为0时删除对象
+         */
+        void Release() const{
+            if(m_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                delete static_cast<const T*>(this);
+            }
+        }
+
+        /**
+         * @brief 获得当前的引用计数，仅用于调试
+         */
+        uint32_t GetRefCount() const{ return m_ref_count.load(std::memory_order_relaxed); }
+
+    protected:
+        ~RefCounted() = default;
+
+    private:
+        mutable std::atomic<uint32_t> m_ref_count {0};
+    };
+
+    /**
+     * @brief 侵入式智能指针，T需要提供AddRef()和Release()方法
+     */
+    template<class T>
+    class IntrusivePtr{
+    public:
+        IntrusivePtr() noexcept = default;
+        IntrusivePtr(std::nullptr_t) noexcept {}
+
+        /**
+         * @param p 对象指针
+         * @param add_ref 是否增加引用计数。为false时表示接管p上已有的一个引用（通常来自detach()）
+         */
+        explicit IntrusivePtr(T* p, bool add_ref = true) noexcept: m_ptr(p){
+            if(m_ptr && add_ref) m_ptr->AddRef();
+        }
+
+        IntrusivePtr(const IntrusivePtr& rhs) noexcept: m_ptr(rhs.m_ptr){
+            if(m_ptr) m_ptr->AddRef();
+        }
+
+        IntrusivePtr(IntrusivePtr&& rhs) noexcept: m_ptr(rhs.m_ptr){
+            rhs.m_ptr = nullptr;
+        }
+
+        ~IntrusivePtr(){
+            if(m_ptr) m_ptr->Release();
+        }
+
+        IntrusivePtr& operator=(const IntrusivePtr& rhs) noexcept{
+            IntrusivePtr(rhs).swap(*this);
+            return *this;
+        }
+
+        IntrusivePtr& operator=(IntrusivePtr&& rhs) noexcept{
+            IntrusivePtr(std::move(rhs)).swap(*this);
+            return *this;
+        }
+
+        IntrusivePtr& operator=(std::nullptr_t) noexcept{
+            reset();
+            return *this;
+        }
+
+        void reset() noexcept{
+            IntrusivePtr().swap(*this);
+        }
+
+        void swap(IntrusivePtr& rhs) noexcept{
+            std::swap(m_ptr, rhs.m_ptr);
+        }
+
+        /**
+         * @brief 放弃对象的所有权但不减少引用计数，返回的裸指针持有一个引用
+         * @note 调用者需要在之后通过Release()或IntrusivePtr(p, false)归还该引用
+         */
+        T* detach() noexcept{
+            T* p = m_ptr;
+            m_ptr = nullptr;
+            return p;
+        }
+
+        T* get() const noexcept{ return m_ptr; }
+        T& operator*() const noexcept{ return *m_ptr; }
+        T* operator->() const noexcept{ return m_ptr; }
+        explicit operator bool() const noexcept{ return m_ptr != nullptr; }
+
+        friend bool operator==(const IntrusivePtr& a, const IntrusivePtr& b) noexcept{ return a.m_ptr == b.m_ptr; }
+        friend bool operator!=(const IntrusivePtr& a, const IntrusivePtr& b) noexcept{ return a.m_ptr != b.m_ptr; }
+        friend bool operator==(const IntrusivePtr& a, std::nullptr_t) noexcept{ return a.m_ptr == nullptr; }
+        friend bool operator!=(const IntrusivePtr& a, std::nullptr_t) noexcept{ return a.m_ptr != nullptr; }
+
+    private:
+        T* m_ptr = nullptr;
+    };
+}
+
+#endif //MYRPC_INTRUSIVE_PTR_H
@@ -23,7 +23,7 @@ namespace MyRPC{
             if(m_connection_closed) {
                 m_sock = Socket::Connect(m_server_addr, m_timeout);
                 if (m_sock) {
-                    m_fiber_pool->Run(std::bind(&TCPClient::handleConnect, this));
+                    m_fiber_pool->Run([this](){ handleConnect(); });
                     m_connection_closed = false;
                     return true;
                 }
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include <string>
+#include <vector>
 
 #include "net/serializer.h"
 #include "net/deserializer.h"
@@ -30,6 +31,7 @@ namespace MyRPC{
         int GetKeepalive() const{return m_keepalive;}
         const InetAddr::ptr& GetRegistryServerAddr() const{return m_registry_server_addr;}
         const std::string& GetLoadBalancer() const{return m_load_balancer;}
+        const std::vector<int>& GetCpuAffinity() const{return m_cpu_affinity;}
 
     private:
         int m_threads_num = 8;
@@ -39,6 +41,7 @@ namespace MyRPC{
 
         InetAddr::ptr m_registry_server_addr;
         std::string m_load_balancer;
+        std::vector<int> m_cpu_affinity; // 协程池线程i绑定在m_cpu_affinity[i % size]号CPU上，为空表示不绑定
 
         LOAD_BEGIN
             LOAD_ALIAS_ITEM(ThreadsNum, m_threads_num)
@@ -46,6 +49,7 @@ namespace MyRPC{
             LOAD_ALIAS_ITEM(KeepAlive, m_keepalive)
             LOAD_ALIAS_ITEM(RegistryServerAddr, m_registry_server_addr)
             LOAD_ALIAS_ITEM(LoadBalancer, m_load_balancer)
+            LOAD_ALIAS_ITEM(CpuAffinity, m_cpu_affinity)
         LOAD_END
 
         SAVE_BEGIN
@@ -54,6 +58,7 @@ namespace MyRPC{
             SAVE_ALIAS_ITEM(KeepAlive, m_keepalive)
             SAVE_ALIAS_ITEM(RegistryServerAddr, m_registry_server_addr)
             SAVE_ALIAS_ITEM(LoadBalancer, m_load_balancer)
+            SAVE_ALIAS_ITEM(CpuAffinity, m_cpu_affinity)
         SAVE_END
     };
 }
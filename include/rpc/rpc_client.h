@@ -96,7 +96,7 @@ namespace MyRPC{
                             return;
                         }else {
                             std::unique_lock<FiberSync::RWMutex> lock(m_conn_table_mutex);
-                            it_conn = m_conn_table.emplace(std::move(server_addr_str), conn).first;
+                            m_conn_table.emplace(server_addr_str, conn);
                         }
                     }else{
                         conn = it_conn->second;
@@ -109,9 +109,11 @@ namespace MyRPC{
                     // 将序列化的函数参数发送到服务器
                     auto err_type = conn->SendRecv(*to_send, recv_buf);
                     if(err_type == RPCClientException::SERVER_CLOSED){
-                        // 删除服务器IP地址对应的连接
+                        // 删除服务器IP地址对应的连接。多个调用者可能同时发现连接关闭，且连接可能已经被替换，
+                        // 因此按地址重新查找，只删除仍然是当前连接的表项
                         std::unique_lock<FiberSync::RWMutex> lock(m_conn_table_mutex);
-                        m_conn_table.erase(it_conn);
+                        auto it = m_conn_table.find(server_addr_str);
+                        if(it != m_conn_table.end() && it->second == conn) m_conn_table.erase(it);
                         promise.set_exception(std::make_exception_ptr(RPCClientException(RPCClientException::SERVER_CLOSED)));
                         return;
                     }
@@ -168,13 +170,14 @@ namespace MyRPC{
                 ServiceQueueNode(std::string_view service_name):m_service_name(service_name){}
 
                 std::string m_service_name;
-                FiberSync::Mutex wait_mutex;
+                FiberSync::Latch m_done {1}; // 收到查询结果或连接关闭时打开
                 bool is_exist = false; // 服务是否存在（服务查询结果）
             };
 
             // 需要从注册服务器接收的服务
             std::list<ServiceQueueNode::ptr> m_service_queue;
             SpinLock m_service_queue_mutex;
+            FiberSync::ConditionVariable<SpinLock> m_service_queue_cv;
 
             int m_connection_handler_thread_id = -1;
 
@@ -2,7 +2,7 @@
 #define MYRPC_RPC_CLIENT_CONNECTION_H
 
 #include "fiber/fiber_sync.h"
-#include "fiber/sync_queue.h"
+#include "fiber/channel.h"
 
 #include "net/tcp_client.h"
 #include "net/inetaddr.h"
@@ -23,8 +23,13 @@ namespace MyRPC{
         RPCClientConnection(InetAddr::ptr& server_addr, FiberPool::ptr& fiberPool, useconds_t timeout, int keep_alive):
                             TCPClient(server_addr, fiberPool, timeout),m_keepalive(keep_alive){}
 
+        // 基类析构函数中调用的是TCPClient::disConnect()，这里需要再次调用以关闭发送队列
+        ~RPCClientConnection() override{disConnect();}
+
         RPCClientException::ErrorType SendRecv(const StringBuffer& to_send, StringBuffer& recv);
 
+        void disConnect() override;
+
         virtual void handleConnect() override;
     private:
         int m_keepalive;
@@ -42,9 +47,11 @@ namespace MyRPC{
             RPCClientException::ErrorType m_err = RPCClientException::HAVENT_BEEN_CALLED;
         };
 
+        static const size_t QUEUE_SIZE = 64; // 消息队列的容量，发送队列满时调用者阻塞
+
         // RPC消息队列
-        SyncQueue<RPCQueueNode::ptr> m_send_queue;
-        SyncQueue<RPCQueueNode::ptr> m_recv_queue;
+        Channel<RPCQueueNode::ptr, QUEUE_SIZE> m_send_queue;
+        Channel<RPCQueueNode::ptr, QUEUE_SIZE> m_recv_queue;
     };
 }
 
@@ -27,18 +27,27 @@ namespace MyRPC{
             return TCPServer::bind();
         }
 
+        /**
+         * @brief 注册服务
+         * @param service_name 服务名称
+         * @param func 服务对应的函数
+         * @param offload 是否将func转移到协程池的工作线程池中执行。计算量较大的服务（如压缩、大对象的序列化）应设置为true，
+         *                否则执行期间同一线程上的其他连接都无法得到处理
+         */
         template<class Func>
-        void RegisterMethod(const std::string& service_name,Func&& func){
-            auto register_func = [this](std::string service_name, Func func){
+        void RegisterMethod(const std::string& service_name, Func&& func, bool offload = false){
+            m_fiber_pool->Run([this, service_name, offload, func = std::forward<Func>(func)](){
                 {
                     std::unique_lock<FiberSync::RWMutex> lock(m_service_table_mutex);
-                    m_service_table.emplace(service_name, [func](RPCSession &proto) -> StringBuffer {
+                    m_service_table.emplace(service_name, [this, offload, func](RPCSession &proto) -> StringBuffer {
                         using func_traits = function_traits<std::decay_t<Func>>;
 
                         typename func_traits::arg_type args;
                         proto.ParseContent(args);
                         try {
-                            auto ret_val = func_traits::apply(func, args);
+                            auto ret_val = offload ? m_fiber_pool->Offload([&func, &args](){
+                                return func_traits::apply(func, args);
+                            }) : func_traits::apply(func, args);
                             return proto.Prepare(MESSAGE_RESPOND_OK, ret_val);
                         } catch (std::exception &e) {
                             std::string msg(e.what());
@@ -47,8 +56,7 @@ namespace MyRPC{
                     });
                 }
                 m_registry.Update(service_name);
-            };
-            m_fiber_pool-> Run(std::bind(register_func, service_name, std::forward<Func>(func)));
+            });
         }
 
         bool ConnectToRegistryServer(){return m_registry.Connect();}
@@ -70,6 +78,8 @@ namespace MyRPC{
                                                         TCPClient(server_addr, fiberPool, timeout),m_keepalive(keep_alive){}
             void Update(std::string_view service_name);
 
+            void disConnect() override;
+
             uint16_t m_port = 0; // 服务器端口
         private:
             int m_keepalive;
@@ -77,11 +87,10 @@ namespace MyRPC{
             // 需要更新到注册服务器的新服务
             std::list<std::string> m_service_queue;
             SpinLock m_service_queue_mutex;
+            FiberSync::ConditionVariable<SpinLock> m_service_queue_cv;
 
             std::atomic<bool> m_connection_closed = {true};
 
-            int m_connection_handler_thread_id = -1;
-
         protected:
 
             virtual void handleConnect() override;
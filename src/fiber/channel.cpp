@@ -0,0 +1,274 @@
+#include "fiber/channel.h"
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "fiber/task_queue.h"
+#include "logger.h"
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <sched.h>
+
+using namespace MyRPC;
+
+ChannelBase::~ChannelBase() {
+    if (m_send_waiters.Size() > 0 || m_recv_waiters.Size() > 0) {
+        Logger::warn("Channel is destroyed with waiting fibers");
+    }
+}
+
+void ChannelBase::WaitList::Push(Waiter* waiter) {
+    waiter->m_prev = m_tail;
+    waiter->m_next = nullptr;
+    if (m_tail) m_tail->m_next = waiter;
+    else m_head = waiter;
+    m_tail = waiter;
+    waiter->m_linked = true;
+    m_size.fetch_add(1, std::memory_order_seq_cst);
+}
+
+void ChannelBase::WaitList::Remove(Waiter* waiter) {
+    if (waiter->m_prev) waiter->m_prev->m_next = waiter->m_next;
+    else m_head = waiter->m_next;
+    if (waiter->m_next) waiter->m_next->m_prev = waiter->m_prev;
+    else m_tail = waiter->m_prev;
+    waiter->m_prev = waiter->m_next = nullptr;
+    waiter->m_linked = false;
+    m_size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+ChannelBase::Waiter* ChannelBase::claim_waiter(WaitList& list) {
+    while (auto waiter = list.Front()) {
+        list.Remove(waiter);
+        bool expected = false;
+        // 所在的Select可能已经由其他分支完成，此时丢弃该等待者
+        if (waiter->m_select->m_done.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return waiter;
+        }
+    }
+    return nullptr;
+}
+
+Fiber* ChannelBase::finish(Waiter* waiter, bool ok) {
+    auto select = waiter->m_select;
+    select->m_index = waiter->m_index;
+    select->m_ok = ok;
+    return select->m_fiber;
+}
+
+void ChannelBase::wake_receiver() {
+    Fiber* fiber = nullptr;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        // 缓冲区中的数据可能已经被其他接收者取走，此时让被唤醒的接收者重试
+        if (auto waiter = claim_waiter(m_recv_waiters)) fiber = finish(waiter, ring_pop(waiter->m_data));
+    }
+    if (fiber) FiberPool::Wake(fiber);
+}
+
+void ChannelBase::wake_sender() {
+    Fiber* fiber = nullptr;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        if (auto waiter = claim_waiter(m_send_waiters)) fiber = finish(waiter, ring_push(waiter->m_data));
+    }
+    if (fiber) FiberPool::Wake(fiber);
+}
+
+ChannelBase::OpResult ChannelBase::try_send_slow(void* value) {
+    Fiber* fiber = nullptr;
+    OpResult ret;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        if (m_closed.load(std::memory_order_relaxed)) return OP_CLOSED;
+
+        if (auto waiter = claim_waiter(m_recv_waiters)) {
+            // 有接收者在等待，直接交给它，不经过缓冲区
+            move_value(waiter->m_data, value);
+            fiber = finish(waiter, true);
+            ret = OP_OK;
+        } else {
+            ret = ring_push(value) ? OP_OK : OP_WOULD_BLOCK;
+        }
+    }
+    if (fiber) FiberPool::Wake(fiber);
+    return ret;
+}
+
+ChannelBase::OpResult ChannelBase::try_recv_slow(void* out) {
+    Fiber* fiber = nullptr;
+    OpResult ret;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        if (ring_pop(out)) {
+            // 缓冲区腾出了位置，将一个等待的发送者的数据移入缓冲区
+            if (auto waiter = claim_waiter(m_send_waiters)) fiber = finish(waiter, ring_push(waiter->m_data));
+            ret = OP_OK;
+        } else if (auto waiter = claim_waiter(m_send_waiters)) {
+            // 无缓冲通道，直接从等待的发送者处取得数据
+            move_value(out, waiter->m_data);
+            fiber = finish(waiter, true);
+            ret = OP_OK;
+        } else {
+            ret = m_closed.load(std::memory_order_relaxed) ? OP_CLOSED : OP_WOULD_BLOCK;
+        }
+    }
+    if (fiber) FiberPool::Wake(fiber);
+    return ret;
+}
+
+void ChannelBase::Close() {
+    LocalTaskQueue<Fiber> to_wake;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        if (m_closed.load(std::memory_order_relaxed)) return;
+        m_closed.store(true, std::memory_order_release);
+
+        // 被唤醒的协程重新尝试时会发现通道已关闭
+        for (auto list: {&m_send_waiters, &m_recv_waiters}) {
+            while (auto waiter = claim_waiter(*list)) to_wake.Push(finish(waiter, false));
+        }
+    }
+    Fiber* fiber;
+    while (to_wake.TryPop(fiber)) FiberPool::Wake(fiber);
+}
+
+bool ChannelBase::has_other_waiter(const WaitList& list, const SelectState* select) {
+    for (auto waiter = list.Front(); waiter; waiter = waiter->m_next) {
+        if (waiter->m_select != select && !waiter->m_select->m_done.load(std::memory_order_acquire)) return true;
+    }
+    return false;
+}
+
+bool ChannelBase::register_waiter(Waiter* waiter, bool is_send) {
+    std::lock_guard<SpinLock> lock(m_lock);
+    if (m_closed.load(std::memory_order_relaxed)) return false;
+
+    auto& list = is_send ? m_send_waiters : m_recv_waiters;
+    list.Push(waiter);
+    // 与快速路径中写入（取出）缓冲区后的栅栏配对：要么快速路径看到当前等待者，要么当前等待者看到缓冲区的变化
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ready = is_send ? ring_can_push() || has_other_waiter(m_recv_waiters, waiter->m_select)
+                         : ring_can_pop() || has_other_waiter(m_send_waiters, waiter->m_select);
+    if (!ready) return true;
+
+    list.Remove(waiter);
+    return false;
+}
+
+void ChannelBase::unregister_waiter(Waiter* waiter, bool is_send) {
+    std::lock_guard<SpinLock> lock(m_lock);
+    if (waiter->m_linked) (is_send ? m_send_waiters : m_recv_waiters).Remove(waiter);
+}
+
+int MyRPC::Select(std::initializer_list<SelectCase> cases, int64_t timeout_us) {
+    using Waiter = ChannelBase::Waiter;
+    using SelectState = ChannelBase::SelectState;
+
+    static thread_local unsigned select_count = 0;
+
+    int n = (int)cases.size();
+    auto select_cases = cases.begin();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us > 0 ? timeout_us : 0);
+
+    // 分支较少时等待者放在栈上
+    static const int LOCAL_WAITERS = 4;
+    Waiter local_waiters[LOCAL_WAITERS];
+    std::vector<Waiter> heap_waiters;
+    Waiter* waiters = local_waiters;
+    if (n > LOCAL_WAITERS) {
+        heap_waiters.resize(n);
+        waiters = heap_waiters.data();
+    }
+
+    while (true) {
+        // 从轮转的位置开始尝试所有分支，多个分支同时可以完成时不总是选择第一个
+        int start = n > 1 ? (int)(select_count++ % n) : 0;
+        for (int k = 0; k < n; k++) {
+            int i = (start + k) % n;
+            auto& select_case = select_cases[i];
+            auto ret = select_case.m_is_send ? select_case.m_channel->try_send_slow(select_case.m_data)
+                                             : select_case.m_channel->try_recv_slow(select_case.m_data);
+            if (ret != ChannelBase::OP_WOULD_BLOCK) {
+                if (select_case.m_ok) *select_case.m_ok = ret == ChannelBase::OP_OK;
+                return i;
+            }
+        }
+
+        if (timeout_us == 0) return -1;
+        int64_t remain_us = -1;
+        if (timeout_us > 0) {
+            remain_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+            if (remain_us <= 0) return -1;
+        }
+
+        // 等待者位于协程栈上，SHARED_STACK协程让出CPU后栈空间会被其他协程使用，因此和协程池之外的线程一样轮询
+        if (Fiber::GetCurrentId() == 0 || FiberPool::GetThis() == nullptr ||
+            Fiber::GetStackType() == StackPool::SHARED_STACK) {
+            if (Fiber::GetCurrentId() != 0) Fiber::Suspend();
+            else sched_yield();
+            continue;
+        }
+
+        SelectState state;
+        state.m_fiber = FiberPool::PrepareBlock();
+
+        // 在所有分支的通道上注册，注册期间某个分支可以完成时不再阻塞，重新尝试所有分支
+        bool self_claimed = false;
+        int registered = 0;
+        while (registered < n && !state.m_done.load(std::memory_order_acquire)) {
+            auto& waiter = waiters[registered];
+            waiter = Waiter();
+            waiter.m_select = &state;
+            waiter.m_data = select_cases[registered].m_data;
+            waiter.m_index = registered;
+            bool ok = select_cases[registered].m_channel->register_waiter(&waiter, select_cases[registered].m_is_send);
+            ++registered;
+            if (!ok) {
+                bool expected = false;
+                self_claimed = state.m_done.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+                break;
+            }
+        }
+
+        bool timed_out = false;
+        if (!self_claimed) {
+            // 阻塞直到某个通道完成了该Select
+            if (remain_us > 0) {
+                // 定时器在当前线程的时间轮上，被唤醒后需要在同一个线程上删除定时器，因此阻塞期间禁止窃取
+                auto fiber = state.m_fiber;
+                bool pinned = fiber->IsPinned();
+                fiber->SetPinned(true);
+                auto event_manager = FiberPool::GetEventManager();
+                event_manager->AddTimerEvent(remain_us);
+                Fiber::Block();
+                if (event_manager->IsExistTimerEvent()) {
+                    event_manager->RemoveTimerEvent();
+                } else {
+                    bool expected = false;
+                    timed_out = state.m_done.compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+                    // 超时的同时某个通道完成了该Select，等待它的唤醒
+                    if (!timed_out) Fiber::Block();
+                }
+                fiber->SetPinned(pinned);
+            } else {
+                Fiber::Block();
+            }
+        }
+
+        for (int i = 0; i < registered; i++) {
+            select_cases[i].m_channel->unregister_waiter(&waiters[i], select_cases[i].m_is_send);
+        }
+
+        // 没有通道唤醒当前协程，归还PrepareBlock()获得的引用
+        if (self_claimed || timed_out) state.m_fiber->Release();
+
+        if (timed_out) return -1;
+        if (!self_claimed && state.m_ok) {
+            auto& select_case = select_cases[state.m_index];
+            if (select_case.m_ok) *select_case.m_ok = true;
+            return state.m_index;
+        }
+    }
+}
@@ -1,17 +1,27 @@
 #include "fiber/event_manager.h"
 #include "macro.h"
 #include <cstring>
+#include <algorithm>
 #include <sys/fcntl.h>
 #include <sys/epoll.h>
 #include "fiber/fiber.h"
 #include "fiber/hook_io.h"
+#include "fiber/fd_state.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
 
 using namespace MyRPC;
 
-EventManager::EventManager() {
+// 边缘触发方式注册的fd，epoll_event.data.u64的高32位保存标志位和fd的代数，低32位保存fd
+static const uint64_t EDGE_TRIGGERED_FLAG = 1ULL << 63;
+static const uint32_t GENERATION_MASK = 0x7fffffff;
+
+static inline uint64_t edge_triggered_data(int fd, uint32_t generation) {
+    return EDGE_TRIGGERED_FLAG | ((uint64_t)(generation & GENERATION_MASK) << 32) | (uint32_t)fd;
+}
+
+EventManager::EventManager(IOBackend backend): m_fd_table(FD_TABLE_INIT_SIZE) {
     // 初始化epoll
     m_epoll_fd = epoll_create(1);
     MYRPC_SYS_ASSERT(m_epoll_fd != -1);
@@ -20,66 +30,131 @@ EventManager::EventManager() {
     m_notify_event_fd = eventfd(0, O_NONBLOCK);
     MYRPC_SYS_ASSERT(m_notify_event_fd > 0);
     MYRPC_SYS_ASSERT(AddWakeupEventfd(m_notify_event_fd) == 0);
+
+    if(backend == IO_URING_BACKEND) {
+        if(m_io_uring.Init(IO_URING_ENTRIES)) {
+            // 完成队列非空时io_uring的文件描述符可读，用以从epoll_wait中唤醒
+            epoll_event event_epoll;
+            memset(&event_epoll, 0, sizeof(epoll_event));
+            event_epoll.data.fd = m_io_uring.GetFd();
+            event_epoll.events = EPOLLIN;
+            MYRPC_SYS_ASSERT(epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_io_uring.GetFd(), &event_epoll) == 0);
+        }else{
+            Logger::warn("io_uring is not available, fall back to epoll");
+        }
+    }
 }
 
 EventManager::~EventManager() {
+    // 释放任务队列中剩余协程的引用
+    Fiber* fiber;
+    drain_inbox();
+    while(m_local_queue.TryPop(fiber)) fiber->Release();
+    while(m_stealable_queue.TryPop(fiber)) fiber->Release();
+    m_timing_wheel.ExpireAll();
+    while(auto node = m_timing_wheel.PopExpired()) static_cast<Fiber*>(node)->Release();
+
+    // 内核可能仍在访问未完成的io_uring请求的缓冲区（位于协程栈上），因此不释放这些协程
+    if(m_io_uring_inflight > 0) {
+        Logger::warn("EventManager is destroyed with {} io_uring requests in flight", m_io_uring_inflight);
+    }
+
     MYRPC_SYS_ASSERT(close(m_notify_event_fd) == 0);
     MYRPC_SYS_ASSERT(close(m_epoll_fd) == 0);
 }
 
 int EventManager::AddIOEvent(int fd, EventType event) {
+    if(fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
     epoll_event event_epoll; // epoll_ctl 的第4个参数
     memset(&event_epoll, 0, sizeof(epoll_event));
 
     int op; // epoll_ctl 的第二个参数
 
     // 当前文件描述符对应的IO事件
-    auto iter = m_adder_map.find(fd);
-    if(iter != m_adder_map.end())
-    {
-        assert(iter->second[event] == 0);
-
-        // event已存在，则修改event
-        iter->second[event] = Fiber::GetSharedFromThis();
-
-        event_epoll.events = EPOLLIN | EPOLLOUT;
-        event_epoll.data.fd = fd;
-
-        op = EPOLL_CTL_MOD;
+    auto& waiter = get_fd_waiter(fd);
+    MYRPC_ASSERT(waiter.fibers[event] == nullptr);
+
+    if(waiter.flags & FdWaiter::EDGE_TRIGGERED) {
+        // 以边缘触发方式注册的fd改为水平触发，已经在等待的协程保留
+        waiter.flags &= ~FdWaiter::EDGE_TRIGGERED;
+        op = (waiter.generation == (FdState::GetGeneration(fd) & GENERATION_MASK)) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    } else {
+        // fd上已有其他事件，则修改event
+        op = (waiter.fibers[READ] != nullptr || waiter.fibers[WRITE] != nullptr) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
     }
-    else{
-        // 目前当前文件描述符没有IO事件
-        std::array<Fiber::ptr,2> tmp = {0};
-        tmp[event] = Fiber::GetSharedFromThis();
-        m_adder_map.emplace(fd, tmp);
-
-        int event_in_epoll = (event == READ) ? EPOLLIN : EPOLLOUT;
-        event_epoll.events = event_in_epoll;
-        event_epoll.data.fd = fd;
+    waiter.fibers[event] = Fiber::GetSharedFromThis();
 
-        op = EPOLL_CTL_ADD;
-    }
+    event_epoll.events = ((waiter.fibers[READ] != nullptr) ? EPOLLIN : 0) | ((waiter.fibers[WRITE] != nullptr) ? EPOLLOUT : 0);
+    event_epoll.data.fd = fd;
 
     // 调用epoll_ctl
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
     auto _e = event_epoll.events;
     Logger::debug("Fiber: {}, call epoll_ctl({}, 0x{:x}, {}, ...), epoll events:0x{:x}", Fiber::GetCurrentId(), m_epoll_fd, op, fd, _e);
 #endif
-    return epoll_ctl(m_epoll_fd, op, fd, &event_epoll);
+    auto ret = epoll_ctl(m_epoll_fd, op, fd, &event_epoll);
+    // 原来的注册已随fd关闭而失效，或者fd被dup过、关闭后原来的注册仍然存在
+    if(ret != 0 && op == EPOLL_CTL_MOD && errno == ENOENT) ret = epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event_epoll);
+    else if(ret != 0 && op == EPOLL_CTL_ADD && errno == EEXIST) ret = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event_epoll);
+    // 添加失败（例如普通文件不支持epoll），不保留协程的引用
+    if(ret != 0) waiter.fibers[event] = nullptr;
+    return ret;
 }
 
-void EventManager::WaitEvent(int thread_id) {
+int EventManager::WaitEvent(int thread_id, int timeout) {
     epoll_event m_events[MAX_EVENTS];
 
-    auto n = epoll_wait(m_epoll_fd, m_events, MAX_EVENTS, TIME_OUT);
+    // 有定时器事件时，epoll_wait最多等待到下一个定时器超时
+    if(timeout < 0) {
+        timeout = TIME_OUT;
+        auto next_tick = m_timing_wheel.NextTimeout(TimingWheel::GetCurrentTick());
+        if(next_tick >= 0) {
+            auto next_ms = (next_tick * TimingWheel::TICK_US + 999) / 1000;
+            if(next_ms < timeout) timeout = next_ms;
+        }
+    }
+
+    // 休眠前提交队列中剩余的io_uring请求（例如上一次处理事件时恢复的协程又提交了新的请求）
+    if(m_io_uring_inflight > 0 && m_io_uring.Pending() > 0) {
+        auto ret = m_io_uring.Submit();
+        MYRPC_ASSERT(ret >= 0 || ret == -EAGAIN || ret == -EBUSY);
+    }
+
+    auto n = epoll_wait(m_epoll_fd, m_events, MAX_EVENTS, timeout);
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
     Logger::debug("Thread: {}, epoll_wait() returned {}", thread_id ,n);
 #endif
     for(int i=0;i<n;i++){
         auto happened_event = m_events[i].events;
-        auto fd = m_events[i].data.fd;
+        auto fd = (int)(uint32_t)m_events[i].data.u64;
+
+        if(m_events[i].data.u64 & EDGE_TRIGGERED_FLAG) {
+            // 边缘触发方式注册的fd，只需要唤醒等待的协程
+            if((size_t)fd >= m_fd_table.size()) continue;
+            auto& waiter = m_fd_table[fd];
+            // 已经改为水平触发，或者已经被关闭的fd上残留的事件
+            if(!(waiter.flags & FdWaiter::EDGE_TRIGGERED) ||
+               waiter.generation != ((m_events[i].data.u64 >> 32) & GENERATION_MASK)) continue;
+
+            if (happened_event & (EPOLLERR | EPOLLHUP)) happened_event |= EPOLLIN | EPOLLOUT;
+            // 恢复协程之前转移出引用，协程可能添加新的IO事件，使m_fd_table扩充
+            Fiber::ptr read_fiber, write_fiber;
+            if(happened_event & EPOLLIN) read_fiber = std::move(waiter.fibers[READ]);
+            if(happened_event & EPOLLOUT) write_fiber = std::move(waiter.fibers[WRITE]);
+            if(read_fiber != nullptr) resume_io_fiber(read_fiber, thread_id);
+            if(write_fiber != nullptr) resume_io_fiber(write_fiber, thread_id);
+            continue;
+        }
+
+        if(fd == m_io_uring.GetFd()) continue; // io_uring请求完成，在process_io_uring()中处理
+        if((size_t)fd >= m_fd_table.size()) continue;
 
-        if(m_wake_up_set.count(fd) > 0){ // eventfd唤醒
+        auto& waiter = m_fd_table[fd];
+        if(waiter.flags & FdWaiter::WAKEUP_FD){ // eventfd唤醒
             auto tmp = enable_hook;
             enable_hook = false;
 
@@ -89,12 +164,10 @@ void EventManager::WaitEvent(int thread_id) {
             enable_hook = tmp;
             continue;
         }
-
-        auto& event_fiber_map = m_adder_map[fd];
-        auto [read_fiber, write_fiber] = event_fiber_map;
+        if(waiter.flags & FdWaiter::EDGE_TRIGGERED) continue; // 已经改为边缘触发
 
         // 在当前文件描述符上添加的IO事件
-        int reg_event = ((event_fiber_map[READ] > 0) ? EPOLLIN: 0) | ((event_fiber_map[WRITE] > 0) ? EPOLLOUT: 0);
+        int reg_event = ((waiter.fibers[READ] != nullptr) ? EPOLLIN: 0) | ((waiter.fibers[WRITE] != nullptr) ? EPOLLOUT: 0);
 
         if (happened_event & (EPOLLERR | EPOLLHUP)){
             happened_event |= ((EPOLLIN | EPOLLOUT) & reg_event);
@@ -105,11 +178,11 @@ void EventManager::WaitEvent(int thread_id) {
         // 获取还未触发的event，并重新注册。若event全部被触发，则删除。
         int left_event = reg_event & (~now_rw_event);
         int op = left_event?EPOLL_CTL_MOD: EPOLL_CTL_DEL;
-        if(!left_event) { // 若event全部被触发，则删除相应的event
-            m_adder_map.erase(fd);
-        }else{
-            event_fiber_map[(now_rw_event == EPOLLIN) ? READ: WRITE] = 0;
-        }
+
+        // 被触发的协程的引用从m_fd_table转移出来
+        Fiber::ptr read_fiber, write_fiber;
+        if(now_rw_event & EPOLLIN) read_fiber = std::move(waiter.fibers[READ]);
+        if(now_rw_event & EPOLLOUT) write_fiber = std::move(waiter.fibers[WRITE]);
         m_events[i].events = left_event;
 
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
@@ -119,19 +192,16 @@ void EventManager::WaitEvent(int thread_id) {
         MYRPC_SYS_ASSERT(epoll_ctl(m_epoll_fd, op, fd, &m_events[i]) == 0);
 
         if(now_rw_event & EPOLLIN){
-            // 读事件发生，恢复相应协程执行
+            // 读事件发生，恢复相应协程执行。协程再次让出CPU或执行完成后放入本地队列，执行完成的协程由协程池回收
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
             Logger::debug("Thread: {}, Fiber: {} is ready to run #1", thread_id, read_fiber->GetId());
 #endif
             auto ret_val = read_fiber->Resume();
-            if(read_fiber->GetStatus() == Fiber::READY)
-                if(!m_task_queue.TryPush(new Fiber::ptr(read_fiber))){
-                    MYRPC_CRITIAL_ERROR("Task queue is full!");
-                }
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
             Logger::debug("Thread: {}, Fiber: {} is swapped out #1, return value:{}, status:{}", thread_id,
                           read_fiber->GetId(), ret_val, read_fiber->GetStatus());
 #endif
+            if(read_fiber->GetStatus() != Fiber::BLOCKED) schedule(read_fiber.detach());
         }
         if(now_rw_event & EPOLLOUT){
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
@@ -139,70 +209,54 @@ void EventManager::WaitEvent(int thread_id) {
 #endif
             // 写事件发生，恢复相应协程执行
             auto ret_val = write_fiber->Resume();
-            if(write_fiber->GetStatus() == Fiber::READY)
-                if(!m_task_queue.TryPush(new Fiber::ptr(write_fiber))){
-                    MYRPC_CRITIAL_ERROR("Task queue is full!");
-                }
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
             Logger::debug("Thread: {}, Fiber: {} is swapped out #1, return value:{}, status:{}", thread_id,
                           write_fiber->GetId(), ret_val, write_fiber->GetStatus());
 #endif
+            if(write_fiber->GetStatus() != Fiber::BLOCKED) schedule(write_fiber.detach());
         }
     }
+
+    process_timers(thread_id);
+    process_io_uring(thread_id);
+    return n;
 }
 
 int EventManager::RemoveIOEvent(int fd, EventManager::EventType event) {
     // 查找fd上是否有事件
-    auto iter = m_adder_map.find(fd);
-    if(iter == m_adder_map.end())
-    {
-        // fd上没有事件，返回
-        return 0;
-    }
-    else{
-        int new_event = 0; // 删除event后当前fd剩余的事件
-        if(event == READ){
-            new_event |= ((iter->second[WRITE] > 0) ? EPOLLOUT: 0);
-        }else if(event == WRITE){
-            new_event |= ((iter->second[READ] > 0) ? EPOLLIN: 0);
-        }
+    if(fd < 0 || (size_t)fd >= m_fd_table.size()) return 0;
+    auto& waiter = m_fd_table[fd];
+    if(waiter.fibers[event] == nullptr) return 0;
+    waiter.fibers[event] = nullptr;
 
-        int op; // epoll_ctl 的第2个参数
-        struct epoll_event event_epoll; // epoll_ctl 的第4个参数
-        memset(&event_epoll, 0, sizeof(epoll_event));
-        event_epoll.data.fd = fd;
-        event_epoll.events = new_event;
+    // 边缘触发方式注册的fd，只需要删除等待的协程
+    if(waiter.flags & FdWaiter::EDGE_TRIGGERED) return 0;
 
-        if(new_event == 0) {
-            m_adder_map.erase(fd);
-            op = EPOLL_CTL_DEL;
-        }else{
-            iter->second[event] = 0;
-            op = EPOLL_CTL_MOD;
-        }
+    // 删除event后当前fd剩余的事件
+    int new_event = ((waiter.fibers[READ] != nullptr) ? EPOLLIN : 0) | ((waiter.fibers[WRITE] != nullptr) ? EPOLLOUT : 0);
+
+    struct epoll_event event_epoll; // epoll_ctl 的第4个参数
+    memset(&event_epoll, 0, sizeof(epoll_event));
+    event_epoll.data.fd = fd;
+    event_epoll.events = new_event;
+    int op = new_event ? EPOLL_CTL_MOD : EPOLL_CTL_DEL; // epoll_ctl 的第2个参数
 
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
-        auto _e = event_epoll.events;
-        Logger::debug("Fiber: {}, call epoll_ctl({}, 0x{:x}, {}, ...), epoll events:0x{:x}", Fiber::GetCurrentId(), m_epoll_fd, op, fd, _e);
+    auto _e = event_epoll.events;
+    Logger::debug("Fiber: {}, call epoll_ctl({}, 0x{:x}, {}, ...), epoll events:0x{:x}", Fiber::GetCurrentId(), m_epoll_fd, op, fd, _e);
 #endif
-        return epoll_ctl(m_epoll_fd, op, fd, &event_epoll);
-    }
+    return epoll_ctl(m_epoll_fd, op, fd, &event_epoll);
 }
 
 bool EventManager::IsExistIOEvent(int fd, EventManager::EventType event) const {
     // 查找fd上是否有事件
-    auto iter = m_adder_map.find(fd);
-    if(iter == m_adder_map.end())
-    {
-        // fd上没有事件，返回
-        return false;
-    }else{
-        return iter->second[event] > 0;
-    }
+    if(fd < 0 || (size_t)fd >= m_fd_table.size()) return false;
+    return m_fd_table[fd].fibers[event] != nullptr;
 }
 
 int EventManager::AddWakeupEventfd(int fd) {
-    if(m_adder_map.find(fd) == m_adder_map.end()) {
+    auto& waiter = get_fd_waiter(fd);
+    if(!(waiter.flags & FdWaiter::WAKEUP_FD)) {
 
         // 将Eventfd设置为非阻塞模式
         int flags;
@@ -212,7 +266,7 @@ int EventManager::AddWakeupEventfd(int fd) {
             MYRPC_SYS_ASSERT(fcntl(fd, F_SETFL, flags) == 0)
         }
 
-        m_wake_up_set.emplace(fd);
+        waiter.flags |= FdWaiter::WAKEUP_FD;
 
         epoll_event event_epoll; // epoll_ctl 的4个参数
         memset(&event_epoll, 0, sizeof(epoll_event));
@@ -232,3 +286,173 @@ void EventManager::Notify() {
     MYRPC_SYS_ASSERT(write(m_notify_event_fd, &val, sizeof(uint64_t)) == sizeof(uint64_t));
     enable_hook = tmp;
 }
+
+size_t EventManager::drain_inbox() {
+    size_t n = 0;
+    Fiber* fiber;
+    while(m_inbox.TryPop(fiber)){
+        m_local_queue.Push(fiber);
+        ++n;
+    }
+    return n;
+}
+
+void EventManager::AddTimerEvent(uint64_t timeout_us) {
+    // 时间轮持有协程的一个引用
+    m_timing_wheel.Add(Fiber::GetSharedFromThis().detach(), TimingWheel::GetExpireTick(timeout_us));
+}
+
+void EventManager::RemoveTimerEvent() {
+    auto fiber = Fiber::GetSharedFromThis();
+    if(fiber->IsTimerActive()) {
+        m_timing_wheel.Remove(fiber.get());
+        fiber->Release();
+    }
+}
+
+bool EventManager::IsExistTimerEvent() const {
+    return Fiber::GetSharedFromThis()->IsTimerActive();
+}
+
+void EventManager::process_timers(int thread_id) {
+    if(m_timing_wheel.Empty()) return;
+    m_timing_wheel.Advance(TimingWheel::GetCurrentTick());
+
+    while(auto node = m_timing_wheel.PopExpired()) {
+        // 超时协程的引用从时间轮转移出来
+        Fiber::ptr timer_fiber(static_cast<Fiber*>(node), false);
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} is ready to run #2", thread_id, timer_fiber->GetId());
+#endif
+        auto ret_val = timer_fiber->Resume();
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} is swapped out #2, return value:{}, status:{}", thread_id,
+                      timer_fiber->GetId(), ret_val, timer_fiber->GetStatus());
+#endif
+        if(timer_fiber->GetStatus() != Fiber::BLOCKED) schedule(timer_fiber.detach());
+    }
+}
+
+// 在协程栈上保存的io_uring请求，user_data指向该结构体
+struct IOUringRequestData {
+    Fiber* fiber; // 持有协程的一个引用
+    int res;
+};
+
+bool EventManager::IsIOUringAvailable() const {
+    return m_io_uring.IsInitialized() && m_io_uring_inflight < m_io_uring.GetCqEntries() &&
+           Fiber::GetStackType() != StackPool::SHARED_STACK;
+}
+
+int EventManager::IOUringRequest(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t off, uint32_t op_flags) {
+    auto sqe = m_io_uring.GetSqe();
+    if(sqe == nullptr) {
+        // 提交队列已满，先提交已有的请求
+        MYRPC_ASSERT(m_io_uring.Submit() >= 0);
+        sqe = m_io_uring.GetSqe();
+        MYRPC_ASSERT(sqe != nullptr);
+    }
+
+    IOUringRequestData data;
+    data.fiber = Fiber::GetSharedFromThis().detach();
+    data.res = 0;
+
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = addr;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->rw_flags = op_flags;
+    sqe->user_data = (uint64_t)&data;
+    ++m_io_uring_inflight;
+
+    // 请求完成后由process_io_uring()恢复执行
+    Fiber::Block();
+    return data.res;
+}
+
+void EventManager::process_io_uring(int thread_id) {
+    if(m_io_uring_inflight == 0) return;
+
+    if(m_io_uring.Pending() > 0) {
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
+        Logger::debug("Thread: {}, submit {} io_uring requests", thread_id, m_io_uring.Pending());
+#endif
+        auto ret = m_io_uring.Submit();
+        MYRPC_ASSERT(ret >= 0 || ret == -EAGAIN || ret == -EBUSY);
+    }
+
+    uint64_t user_data;
+    int32_t res;
+    while(m_io_uring.PopCqe(user_data, res)) {
+        --m_io_uring_inflight;
+        auto data = (IOUringRequestData*)user_data;
+        data->res = res;
+
+        // 请求完成，协程的引用从请求中转移出来
+        Fiber::ptr io_fiber(data->fiber, false);
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} is ready to run #3", thread_id, io_fiber->GetId());
+#endif
+        auto ret_val = io_fiber->Resume();
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} is swapped out #3, return value:{}, status:{}", thread_id,
+                      io_fiber->GetId(), ret_val, io_fiber->GetStatus());
+#endif
+        if(io_fiber->GetStatus() != Fiber::BLOCKED) schedule(io_fiber.detach());
+    }
+}
+
+int EventManager::AddEdgeTriggeredIOEvent(int fd, EventType event) {
+    if(!FdState::IsTracked(fd)) return AddIOEvent(fd, event);
+
+    auto generation = FdState::GetGeneration(fd) & GENERATION_MASK;
+    auto& waiter = get_fd_waiter(fd);
+    if(!(waiter.flags & FdWaiter::EDGE_TRIGGERED) || waiter.generation != generation) {
+        // fd还没有注册，或者原来注册的fd已被关闭，需要（重新）注册
+        epoll_event event_epoll;
+        memset(&event_epoll, 0, sizeof(epoll_event));
+        event_epoll.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        event_epoll.data.u64 = edge_triggered_data(fd, generation);
+
+        // fd正在以水平触发方式等待事件时，改为边缘触发，已经在等待的协程保留
+        int op = (!(waiter.flags & FdWaiter::EDGE_TRIGGERED) &&
+                  (waiter.fibers[READ] != nullptr || waiter.fibers[WRITE] != nullptr)) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_EPOLL_LEVEL
+        auto _e = event_epoll.events;
+        Logger::debug("Fiber: {}, call epoll_ctl({}, 0x{:x}, {}, ...), epoll events:0x{:x}", Fiber::GetCurrentId(), m_epoll_fd, op, fd, _e);
+#endif
+        auto ret = epoll_ctl(m_epoll_fd, op, fd, &event_epoll);
+        // fd被dup过时，关闭后原来的注册仍然存在
+        if(ret != 0 && errno == EEXIST) ret = epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &event_epoll);
+        if(ret != 0 && errno == ENOENT) ret = epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event_epoll);
+        if(ret != 0) return ret;
+
+        waiter.flags |= FdWaiter::EDGE_TRIGGERED;
+        waiter.generation = generation;
+    }
+
+    MYRPC_ASSERT(waiter.fibers[event] == nullptr);
+    waiter.fibers[event] = Fiber::GetSharedFromThis();
+    return 0;
+}
+
+EventManager::FdWaiter& EventManager::get_fd_waiter(int fd) {
+    if((size_t)fd >= m_fd_table.size()) {
+        m_fd_table.resize(std::max((size_t)fd + 1, m_fd_table.size() * 2));
+    }
+    return m_fd_table[fd];
+}
+
+void EventManager::resume_io_fiber(Fiber::ptr& fiber, int thread_id) {
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+    Logger::debug("Thread: {}, Fiber: {} is ready to run #1", thread_id, fiber->GetId());
+#endif
+    auto ret_val = fiber->Resume();
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+    Logger::debug("Thread: {}, Fiber: {} is swapped out #1, return value:{}, status:{}", thread_id,
+                  fiber->GetId(), ret_val, fiber->GetStatus());
+#endif
+    if(fiber->GetStatus() != Fiber::BLOCKED) schedule(fiber.detach());
+}
@@ -0,0 +1,48 @@
+#include "fiber/fd_state.h"
+
+namespace MyRPC{
+
+std::atomic<std::atomic<uint32_t>*> FdState::s_chunks[MAX_FD / CHUNK_SIZE];
+
+std::atomic<uint32_t>* FdState::get_chunk(int fd) {
+    auto& slot = s_chunks[fd / CHUNK_SIZE];
+    auto chunk = slot.load(std::memory_order_acquire);
+    if(chunk) return chunk;
+
+    auto new_chunk = new std::atomic<uint32_t>[CHUNK_SIZE];
+    for(int i = 0; i < CHUNK_SIZE; i++) new_chunk[i].store(0, std::memory_order_relaxed);
+    if(slot.compare_exchange_strong(chunk, new_chunk, std::memory_order_acq_rel)) return new_chunk;
+
+    // 其他线程已经分配了该块
+    delete[] new_chunk;
+    return chunk;
+}
+
+uint32_t FdState::GetGeneration(int fd) {
+    if(!IsTracked(fd)) return 0;
+    return get_chunk(fd)[fd % CHUNK_SIZE].load(std::memory_order_acquire) >> FLAG_BITS;
+}
+
+uint32_t FdState::GetFlags(int fd) {
+    if(!IsTracked(fd)) return 0;
+    return get_chunk(fd)[fd % CHUNK_SIZE].load(std::memory_order_acquire) & ((1U << FLAG_BITS) - 1);
+}
+
+void FdState::SetFlags(int fd, uint32_t flags) {
+    if(!IsTracked(fd)) return;
+    get_chunk(fd)[fd % CHUNK_SIZE].fetch_or(flags, std::memory_order_acq_rel);
+}
+
+void FdState::Invalidate(int fd) {
+    if(!IsTracked(fd)) return;
+    // 未分配的块中的fd从未被记录过状态，不需要处理
+    auto chunk = s_chunks[fd / CHUNK_SIZE].load(std::memory_order_acquire);
+    if(!chunk) return;
+
+    auto& state = chunk[fd % CHUNK_SIZE];
+    auto old_state = state.load(std::memory_order_relaxed);
+    while(!state.compare_exchange_weak(old_state, ((old_state >> FLAG_BITS) + 1) << FLAG_BITS,
+                                       std::memory_order_acq_rel));
+}
+
+}
@@ -3,6 +3,14 @@
 #include "macro.h"
 #include "fiber/hook_sleep.h"
 #include "fiber/hook_io.h"
+#include "fiber/stack_pool.h"
+
+#include <mutex>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 extern "C"{
     extern void myrpc_ctx_switch(void* switch_out_ctx, void* switch_in_ctx);
@@ -73,24 +81,34 @@ void Fiber::init_stack_and_ctx() {
 #endif
 }
 
-Fiber::Fiber(const std::function<void()>& func) : m_fiber_id(++fiber_count), m_func(func), m_status(READY) {
-    m_stack_size = init_stack_size;
-    m_stack = (char*) aligned_alloc(64, sizeof(char) * init_stack_size);
-    if(m_stack)
-        init_stack_and_ctx();
-}
+// 线程的共享栈，由该线程上所有SHARED_STACK协程共同持有
+struct Fiber::SharedStack{
+    char* stack = nullptr;
+    size_t size = SHARED_STACK_SIZE;
+    Fiber* owner = nullptr; // 共享栈上当前保存的是哪个协程的栈内容
 
-Fiber::Fiber(std::function<void()>&& func) : m_fiber_id(++fiber_count), m_func(std::move(func)), m_status(READY) {
-    m_stack_size = init_stack_size;
-    m_stack = (char*) aligned_alloc(64, sizeof(char) * init_stack_size);;
-    if(m_stack)
-        init_stack_and_ctx();
+    SharedStack(){
+        // 使用带保护页的mmap协程栈，只有实际使用的部分占用物理内存
+        stack = (char*) StackPool::Alloc(size, StackPool::MMAP_STACK);
+    }
+
+    ~SharedStack(){
+        if(stack) StackPool::Free(stack, size, StackPool::MMAP_STACK);
+    }
+};
+
+Fiber::Fiber(Task&& func, size_t stack_size, StackPool::StackType stack_type) :
+    m_fiber_id(++fiber_count), m_func(std::move(func)), m_status(READY), m_stack_type(stack_type) {
+    m_stack_size = stack_size ? stack_size : DEFAULT_STACK_SIZE;
 }
 
 Fiber::~Fiber() {
     if (m_status == EXEC) {
         MYRPC_CRITIAL_ERROR("Try to close a running fiber, id: " + std::to_string(m_fiber_id));
-    }else if(m_status != TERMINAL && m_status != ERROR){
+    }else if(m_stack != nullptr && m_status != TERMINAL && m_status != ERROR && !can_unwind()){
+        Logger::warn("Fiber{} is destroyed on its own shared stack, skip stack unwinding", m_fiber_id);
+    }else if(m_stack != nullptr && m_status != TERMINAL && m_status != ERROR){
+        switch_in_stack();
         // stack unwinding
 #if defined(__x86_64__) || defined(_M_X64)
         void** rsp = (void**)m_ctx[SUBCO_CTX_OFS + SP_CTX_OFS];
@@ -105,8 +123,102 @@ Fiber::~Fiber() {
         // 切换上下文
         RESUME(m_ctx);
     }
-    if(m_stack != nullptr)
-        free(m_stack);
+    release_stack();
+}
+
+bool Fiber::alloc_stack() {
+    // 协程栈在第一次运行时才从当前线程的内存池中分配，这样协程栈总是在运行它的线程上分配和回收
+    m_stack = (char*) StackPool::Alloc(m_stack_size, m_stack_type);
+    if(!m_stack) return false;
+    m_stack_alloc_size = m_stack_size;
+
+    // 带保护页的协程栈需要处理SIGSEGV：可增长的协程栈在缺页时自动扩充，栈溢出时输出错误信息
+    if(m_stack_type != StackPool::MALLOC_STACK) install_stack_fault_handler();
+
+    init_stack_and_ctx();
+    return true;
+}
+
+void Fiber::release_stack() {
+    if(m_stack_type == StackPool::SHARED_STACK){
+        if(m_shared_stack && m_shared_stack->owner == this) m_shared_stack->owner = nullptr;
+        m_shared_stack.reset();
+        free(m_save_buffer);
+        m_save_buffer = nullptr;
+        m_save_size = m_save_capacity = 0;
+        m_stack = nullptr;
+        return;
+    }
+    if(m_stack != nullptr){
+        if(m_stack_size != m_stack_alloc_size){
+            // 协程栈被扩充过，先恢复到分配时的大小再归还给内存池
+            void* stack = m_stack;
+            MYRPC_ASSERT(StackPool::Resize(stack, m_stack_size, m_stack_alloc_size));
+            m_stack = (char*)stack;
+        }
+        StackPool::Free(m_stack, m_stack_size, m_stack_type);
+        m_stack = nullptr;
+    }
+}
+
+bool Fiber::switch_in_stack() {
+    if(m_stack_type != StackPool::SHARED_STACK){
+        if(m_stack == nullptr) return alloc_stack();
+        // 协程可能被其他线程窃取，在新的线程上同样需要处理协程栈的SIGSEGV
+        if(m_stack_type != StackPool::MALLOC_STACK) install_stack_fault_handler();
+        return true;
+    }
+
+    if(!m_shared_stack){
+        static thread_local std::shared_ptr<SharedStack> thread_shared_stack;
+        if(!thread_shared_stack){
+            auto shared_stack = std::make_shared<SharedStack>();
+            if(!shared_stack->stack) return false;
+            install_stack_fault_handler();
+            thread_shared_stack = std::move(shared_stack);
+        }
+        m_shared_stack = thread_shared_stack;
+    }
+
+    auto shared_stack = m_shared_stack.get();
+    if(shared_stack->owner == this) return true; // 栈上的内容仍然是本协程的，无需拷贝
+
+    // 换出共享栈当前的占用者，再换入本协程的栈
+    if(shared_stack->owner) shared_stack->owner->save_shared_stack();
+    shared_stack->owner = this;
+    if(m_stack == nullptr){
+        m_stack = shared_stack->stack;
+        m_stack_size = m_stack_alloc_size = shared_stack->size;
+        init_stack_and_ctx();
+    }else{
+        restore_shared_stack();
+    }
+    return true;
+}
+
+void Fiber::save_shared_stack() {
+    // 只需要保存栈指针到栈顶之间已使用的部分
+    char* sp = (char*)m_ctx[SUBCO_CTX_OFS + SP_CTX_OFS];
+    m_save_size = m_stack + m_stack_size - sp;
+    if(m_save_size > m_save_capacity || m_save_size < m_save_capacity / 4){
+        // 保存缓冲区的大小跟随栈的实际使用量
+        free(m_save_buffer);
+        m_save_capacity = (m_save_size + 63) & ~(size_t)63;
+        m_save_buffer = (char*) malloc(m_save_capacity);
+        MYRPC_ASSERT(m_save_buffer != nullptr);
+    }
+    memcpy(m_save_buffer, sp, m_save_size);
+}
+
+void Fiber::restore_shared_stack() {
+    memcpy(m_stack + m_stack_size - m_save_size, m_save_buffer, m_save_size);
+}
+
+bool Fiber::can_unwind() const {
+    if(m_stack_type != StackPool::SHARED_STACK) return true;
+    // 正在共享栈上运行的协程无法被换出，此时不能换入本协程的栈
+    auto ptr = GET_THIS();
+    return !(ptr && ptr->m_shared_stack == m_shared_stack);
 }
 
 void Fiber::Suspend(int64_t return_value) {
@@ -142,11 +254,19 @@ void Fiber::Exit(int64_t return_value) {
 
 int64_t Fiber::Resume() {
     if (m_status == READY || m_status == BLOCKED) {
+        if (!switch_in_stack()) {
+            Logger::error("Failed to allocate stack for fiber{}", m_fiber_id);
+            m_status = ERROR;
+            return 0;
+        }
         SWAP_IN();
         m_status = EXEC;
 
         // 切换上下文
         RESUME(m_ctx);
+
+        // 协程执行完成，立即将协程栈归还给当前线程的内存池
+        if (m_status == TERMINAL) release_stack();
     } else if (m_status == EXEC) {
         Logger::warn("Trying to resume fiber{} which is in execution!", m_fiber_id);
     } else {
@@ -158,8 +278,13 @@ int64_t Fiber::Resume() {
 void Fiber::Reset() {
     if (m_status == TERMINAL || m_status == ERROR) {
         m_status = READY;
-        init_stack_and_ctx();
-    } else {
+        release_stack();
+    } else if (m_stack != nullptr && !can_unwind()) {
+        Logger::warn("Fiber{} is reset on its own shared stack, skip stack unwinding", m_fiber_id);
+        release_stack();
+        m_status = READY;
+    } else if (m_stack != nullptr) {
+        switch_in_stack();
         // Stack Unwinding
 #if defined(__x86_64__) || defined(_M_X64)
         void** rsp = (void**)m_ctx[SUBCO_CTX_OFS + SP_CTX_OFS];
@@ -174,6 +299,9 @@ void Fiber::Reset() {
 
         // 切换上下文
         RESUME(m_ctx);
+
+        release_stack();
+        m_status = READY;
     }
 }
 
@@ -220,54 +348,120 @@ void Fiber::Main() {
 }
 
 Fiber::ptr Fiber::GetSharedFromThis() {
-    return GET_THIS()->shared_from_this();
+    return Fiber::ptr(GET_THIS());
 }
 
 size_t Fiber::GetStacksize() {
     return GET_THIS()->m_stack_size;
 }
 
+StackPool::StackType Fiber::GetStackType() {
+    return GET_THIS()->m_stack_type;
+}
+
 size_t Fiber::GetStackFreeSize() {
     char* stack = GET_THIS()->m_stack;
-    char* rsp;
-    asm volatile("movq %%rsp, %0":"=g"(rsp));
-    return (size_t)(rsp-stack);
+    char* sp;
+#if defined(__x86_64__) || defined(_M_X64)
+    asm volatile("movq %%rsp, %0":"=g"(sp));
+#elif defined(__aarch64__)
+    asm volatile("mov %0, sp":"=r"(sp));
+#endif
+    return (size_t)(sp-stack);
 }
 
 bool Fiber::ExtendStackCapacity() {
-    /*
-    Fiber* volatile ptr = GET_THIS();
-    size_t volatile new_stack_size = ptr->m_stack_size * 2;
-    char* volatile new_stack = (char*) std::aligned_alloc(4096, sizeof(char) * new_stack_size);
-
-    char volatile *rsp;
-    char volatile *rbp;
-    char *new_rsp, *new_rbp;
-    asm volatile("movq %%rsp, %0":"=g"(rsp));
-    asm volatile("movq %%rbp, %0":"=g"(rbp));
-
-    size_t rsp_ofs, rbp_ofs;
-    if(!new_stack)
+    auto ptr = GET_THIS();
+    if(ptr == nullptr || ptr->m_stack_type != StackPool::GROWABLE_STACK) {
+        // 只有GROWABLE_STACK协程栈可以原地扩充，其他协程栈中可能存在指向栈内的指针，无法搬移
         return false;
+    }
+    void* stack = ptr->m_stack;
+    if(!StackPool::Resize(stack, ptr->m_stack_size, ptr->m_stack_size * 2)) return false;
+    ptr->m_stack = (char*)stack;
+    return true;
+}
+
+// 用于处理SIGSEGV信号的备用信号栈，协程栈溢出时无法在协程栈上处理信号
+struct AltSignalStack{
+    static const size_t SIZE = 65536;
+
+    void* mem = nullptr;
+
+    void Install(){
+        if(mem) return;
+        mem = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        MYRPC_SYS_ASSERT(mem != MAP_FAILED);
+        stack_t ss;
+        memset(&ss, 0, sizeof(ss));
+        ss.ss_sp = mem;
+        ss.ss_size = SIZE;
+        MYRPC_SYS_ASSERT(sigaltstack(&ss, nullptr) == 0);
+    }
+
+    ~AltSignalStack(){
+        if(mem){
+            stack_t ss;
+            memset(&ss, 0, sizeof(ss));
+            ss.ss_flags = SS_DISABLE;
+            sigaltstack(&ss, nullptr);
+            munmap(mem, SIZE);
+        }
+    }
+};
 
-    memcpy(new_stack+ptr->m_stack_size, ptr->m_stack, ptr->m_stack_size);
+static thread_local AltSignalStack alt_signal_stack;
 
-    rsp_ofs = (ptr->m_stack + ptr->m_stack_size) - rsp;
-    rbp_ofs = (ptr->m_stack + ptr->m_stack_size) - rbp;
+static struct sigaction old_sigsegv_action;
 
-    new_rsp = new_stack + new_stack_size - rsp_ofs;
-    new_rbp = new_stack + new_stack_size - rbp_ofs;
+static void write_stderr(const char* msg){
+    // 信号处理函数中不能使用Logger，也不能调用被hook的write
+    syscall(SYS_write, STDERR_FILENO, msg, strlen(msg));
+}
 
+void Fiber::stack_fault_handler(int sig, siginfo_t* info, void* ucontext) {
+    auto ptr = GET_THIS();
+    auto addr = (char*)info->si_addr;
+    if(ptr && ptr->m_stack && ptr->m_stack_type != StackPool::MALLOC_STACK && addr < ptr->m_stack){
+        auto page_size = StackPool::GetPageSize();
+        auto top = ptr->m_stack + ptr->m_stack_size;
+
+        if(ptr->m_stack_type == StackPool::GROWABLE_STACK && addr >= top - StackPool::GROWABLE_STACK_RESERVE + page_size){
+            // 访问了预留空间中尚不可访问的部分，扩充协程栈
+            size_t new_size = ptr->m_stack_size;
+            while(top - new_size > addr) new_size *= 2;
+            if(new_size > StackPool::GROWABLE_STACK_RESERVE - page_size)
+                new_size = StackPool::GROWABLE_STACK_RESERVE - page_size;
+
+            void* stack = ptr->m_stack;
+            if(StackPool::Resize(stack, ptr->m_stack_size, new_size)){
+                ptr->m_stack = (char*)stack;
+                return; // 返回后重新执行触发异常的指令
+            }
+        }
 
-    asm volatile("movq %0, %%rsp":"=r"(new_rsp));
-    asm volatile("movq %0, %%rbp":"=r"(new_rbp));
+        auto reserve = (ptr->m_stack_type == StackPool::GROWABLE_STACK) ? StackPool::GROWABLE_STACK_RESERVE :
+                                                                           ptr->m_stack_size + page_size;
+        if(addr >= top - reserve){
+            write_stderr("MyRPC: fiber stack overflow\n");
+        }
+    }
 
-    auto tmp = ptr->m_stack;
-    ptr->m_stack = new_stack;
-    ptr->m_stack_size = new_stack_size;
-    free(tmp);*/
+    // 不是可以处理的协程栈异常，恢复原来的信号处理函数，返回后重新触发异常
+    sigaction(SIGSEGV, &old_sigsegv_action, nullptr);
+}
 
-    MYRPC_NO_IMPLEMENTATION_ERROR();
+void Fiber::install_stack_fault_handler() {
+    static std::once_flag flag;
+    std::call_once(flag, [](){
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = &Fiber::stack_fault_handler;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        MYRPC_SYS_ASSERT(sigaction(SIGSEGV, &action, &old_sigsegv_action) == 0);
+    });
+    alt_signal_stack.Install();
 }
 
-}
\ No newline at end of file
+}
@@ -1,11 +1,13 @@
 #include "fiber/fiber_pool.h"
 #include "macro.h"
+#include "arch.h"
 #include <fcntl.h>
 #include <chrono>
 #include <mutex>
+#include <cstring>
 #include <unistd.h>
-
-#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
 
 namespace MyRPC {
 
@@ -15,18 +17,14 @@ static thread_local FiberPool *p_fiber_pool = nullptr;
 // 当前线程id
 static thread_local int now_thread_id = -2;
 
-FiberPool::FiberPool(int thread_num) : m_threads_num(thread_num) {
+FiberPool::FiberPool(int thread_num, EventManager::IOBackend io_backend) : m_threads_num(thread_num),
+                                                                          m_io_backend(io_backend) {
     m_threads_context_ptr.reserve(thread_num);
     m_threads_future.reserve(thread_num);
-
-    // 创建event_fd
-    m_global_event_fd = eventfd(0, O_NONBLOCK);
-    MYRPC_ASSERT(m_global_event_fd > 0);
 }
 
 FiberPool::~FiberPool() {
     if (m_running) Stop();
-    close(m_global_event_fd);
 
     for(auto threads_context: m_threads_context_ptr) delete threads_context;
 }
@@ -36,12 +34,15 @@ void FiberPool::Start() {
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_ON_LEVEL
         Logger::info("FiberPool::Start() - start");
 #endif
+        // 事件管理器由各线程在绑定CPU之后创建，等待所有线程创建完成后才能向线程提交协程
+        m_threads_context_ptr.assign(m_threads_num, nullptr);
+        m_started_threads = 0;
         for (int i = 0; i < m_threads_num; i++) {
-            m_threads_context_ptr.push_back(new EventManager);
-            // 添加读eventfd事件，用以唤醒线程
-            m_threads_context_ptr[i]->AddWakeupEventfd(m_global_event_fd);
             m_threads_future.push_back(std::async(std::launch::async, &FiberPool::MainLoop, this, i));
         }
+        while (m_started_threads < m_threads_num) {
+            sched_yield();
+        }
         m_running = true;
     }
 }
@@ -61,6 +62,9 @@ void FiberPool::Stop() {
             }
             MYRPC_ASSERT(m_threads_future[i].get() == 0);
         }
+        // 阻塞IO线程池和工作线程池在完成操作后会访问线程的事件管理器，因此在删除事件管理器之前停止
+        m_blocking_io_pool.Stop();
+        m_offload_pool.Stop();
         for(auto threads_context: m_threads_context_ptr) delete threads_context;
         m_threads_context_ptr.clear();
         m_threads_future.clear();
@@ -68,12 +72,22 @@ void FiberPool::Stop() {
     }
 }
 
+bool FiberPool::wakeup(int thread_id) {
+    auto context_ptr = m_threads_context_ptr[thread_id];
+    // 与MainLoop中设置休眠标志后的检查配对，保证提交的协程和休眠标志至少有一方被对方看到
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 只有清除休眠标志的线程才写eventfd，线程忙碌或已经被唤醒时不需要系统调用
+    if (context_ptr->m_sleeping.load(std::memory_order_relaxed) && context_ptr->m_sleeping.exchange(false)) {
+        --m_idle_threads;
+        context_ptr->m_wakeup_count.fetch_add(1, std::memory_order_relaxed);
+        context_ptr->Notify();
+        return true;
+    }
+    return false;
+}
+
 void FiberPool::NotifyAll() {
-    auto tmp = enable_hook;
-    enable_hook = false;
-    uint64_t val = 1;
-    MYRPC_SYS_ASSERT(write(m_global_event_fd, &val, sizeof(uint64_t)) == sizeof(uint64_t));
-    enable_hook = tmp;
+    for (int i = 0; i < (int)m_threads_context_ptr.size(); i++) wakeup(i);
 }
 
 int FiberPool::GetCurrentThreadId() {
@@ -92,11 +106,53 @@ EventManager* FiberPool::GetEventManager() {
     return nullptr;
 }
 
+bool FiberPool::run_offloaded(OffloadPool& pool, std::function<void()> func) {
+    if (GetThis() != this || Fiber::GetCurrentId() == 0 || Fiber::GetStackType() == StackPool::SHARED_STACK) {
+        return false;
+    }
+
+    // 线程池持有协程的一个引用，操作完成后提交回当前线程
+    auto fiber = PrepareBlock();
+    pool.Submit([fiber, func = std::move(func)]() {
+        func();
+        Wake(fiber);
+    });
+    Fiber::Block();
+    return true;
+}
+
+Fiber* FiberPool::PrepareBlock() {
+    if (p_fiber_pool == nullptr || Fiber::GetCurrentId() == 0) return nullptr;
+
+    auto fiber = Fiber::GetSharedFromThis().detach();
+    fiber->m_block_pool = p_fiber_pool;
+    fiber->m_block_thread_id = now_thread_id;
+    return fiber;
+}
+
+void FiberPool::Wake(Fiber* fiber) {
+    auto pool = fiber->m_block_pool;
+    auto thread_id = fiber->m_block_thread_id;
+    MYRPC_ASSERT(pool != nullptr && thread_id >= 0);
+
+    // 线程在协程让出CPU之后才会处理收件箱。在协程阻塞时所在的线程上唤醒时，协程一定已经让出了CPU
+    if (p_fiber_pool == pool && now_thread_id == thread_id) {
+        pool->m_threads_context_ptr[thread_id]->schedule(fiber);
+    } else {
+        pool->m_threads_context_ptr[thread_id]->submit(fiber);
+        pool->wakeup(thread_id);
+    }
+}
+
 int FiberPool::MainLoop(int thread_id) {
     now_thread_id = thread_id;
     p_fiber_pool = this;
 
-    auto context_ptr = m_threads_context_ptr[thread_id];
+    bind_cpu(thread_id);
+    auto context_ptr = new EventManager(m_io_backend);
+    if (m_idle_policy == SPIN_THEN_PARK) context_ptr->m_spin_us = m_max_spin_us;
+    m_threads_context_ptr[thread_id] = context_ptr;
+    ++m_started_threads;
 
     while(!m_running){
         sched_yield();
@@ -105,57 +161,237 @@ int FiberPool::MainLoop(int thread_id) {
     while (true) {
         if (m_stopping) return 0;
 
-        Fiber::ptr* tsk_ptr_from_q = nullptr;
-        // 1. 调度线程的所有协程
-        while(context_ptr->m_task_queue.TryPop(tsk_ptr_from_q)){
-            auto tsk_ptr = *tsk_ptr_from_q;
+        // 1. 将其他线程提交的协程批量移入本地队列
+        context_ptr->drain_inbox();
+
+        // 2. 调度本地队列中的协程，每一轮最多执行本轮开始时队列中的协程数量，之后重新检查收件箱
+        // 任务队列中的每个Fiber*持有协程的一个引用，出队后由当前线程持有，重新入队时直接转移，不修改引用计数
+        Fiber* tsk_ptr = nullptr;
+        auto n_tasks = context_ptr->m_local_queue.Size();
+        for (size_t i = 0; i < n_tasks && context_ptr->m_local_queue.TryPop(tsk_ptr); i++) {
+            run_task(context_ptr, tsk_ptr);
+        }
+
+        // 线程忙碌时不会进入epoll_wait，因此每一轮都检查一次超时的定时器，并批量提交io_uring请求
+        context_ptr->process_timers(thread_id);
+        context_ptr->process_io_uring(thread_id);
+
+        if (m_work_stealing) {
+            if (m_idle_threads > 0 && context_ptr->m_local_queue.Size() > 1) {
+                publish_tasks(thread_id);
+            }
+            // 本地队列为空时，取回已发布但还没有被其他线程窃取的协程
+            if (context_ptr->m_local_queue.Empty()) {
+                while (context_ptr->m_stealable_queue.TryPop(tsk_ptr)) context_ptr->schedule(tsk_ptr);
+            }
+        }
+        if (!context_ptr->m_local_queue.Empty() || !context_ptr->m_inbox.Empty()) continue;
+
+        // 3. 线程空闲时，在等待epoll事件之前先尝试从其他线程窃取协程，之后按照等待策略自旋一段时间
+        if (m_work_stealing && steal(thread_id)) continue;
+        if (m_idle_policy == SPIN_THEN_PARK && spin(thread_id)) continue;
+
+        // 4. 标记为休眠，之后其他线程才会通过eventfd唤醒当前线程。标记之后再检查一次，避免错过在此之前提交的协程
+        context_ptr->m_sleeping.store(true, std::memory_order_relaxed);
+        ++m_idle_threads;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!context_ptr->m_inbox.Empty() || m_stopping || (m_work_stealing && steal(thread_id))) {
+            if (context_ptr->m_sleeping.exchange(false)) --m_idle_threads;
+            continue;
+        }
+
+        // 5. 处理epoll事件
+        context_ptr->m_park_count.fetch_add(1, std::memory_order_relaxed);
+        if (m_idle_policy == SPIN_THEN_PARK) {
+            auto park_start = std::chrono::steady_clock::now();
+            context_ptr->WaitEvent(now_thread_id);
+            // 休眠后很快被唤醒，说明自旋更长时间就能等到新任务
+            adjust_spin(context_ptr, std::chrono::steady_clock::now() - park_start <
+                                     std::chrono::microseconds(m_max_spin_us));
+        } else {
+            context_ptr->WaitEvent(now_thread_id);
+        }
+
+        if (context_ptr->m_sleeping.exchange(false)) --m_idle_threads;
+    }
+}
+
+bool FiberPool::spin(int thread_id) {
+    // 每自旋SPIN_POLL_INTERVAL次轮询一次epoll并检查是否超时，其余时间只检查收件箱
+    static const unsigned SPIN_POLL_INTERVAL = 16;
 
-            MYRPC_ASSERT(tsk_ptr->GetStatus() != Fiber::ERROR);
-            if (tsk_ptr->GetStatus() == Fiber::READY) { // 如果任务已就绪，那么执行任务
+    auto context_ptr = m_threads_context_ptr[thread_id];
+    if (context_ptr->m_spin_us == 0) return false;
+    context_ptr->m_spin_count.fetch_add(1, std::memory_order_relaxed);
+
+    // 自旋的线程同样视为空闲，其他线程有协程积压时会发布可窃取的协程
+    ++m_idle_threads;
+    bool hit = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(context_ptr->m_spin_us);
+    for (unsigned i = 1; !m_stopping; i++) {
+        if (!context_ptr->m_inbox.Empty()) {
+            hit = true;
+            break;
+        }
+        if (i % SPIN_POLL_INTERVAL == 0) {
+            if (context_ptr->WaitEvent(thread_id, 0) > 0 || !context_ptr->m_local_queue.Empty() ||
+                (m_work_stealing && steal(thread_id))) {
+                hit = true;
+                break;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) break;
+        }
+        MYRPC_PAUSE;
+    }
+    --m_idle_threads;
+
+    if (hit) {
+        context_ptr->m_spin_hit_count.fetch_add(1, std::memory_order_relaxed);
+        adjust_spin(context_ptr, true);
+    }
+    return hit || m_stopping;
+}
+
+void FiberPool::adjust_spin(EventManager* context_ptr, bool grow) {
+    static const useconds_t MIN_SPIN_US = 1;
+
+    auto& spin_us = context_ptr->m_spin_us;
+    if (grow) spin_us = std::min(m_max_spin_us, std::max(spin_us * 2, MIN_SPIN_US));
+    else spin_us /= 2;
+}
+
+void FiberPool::bind_cpu(int thread_id) {
+    if (m_cpu_affinity.empty()) return;
+
+    int cpu = m_cpu_affinity[thread_id % m_cpu_affinity.size()];
+    int err = EINVAL;
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+    // 绑定失败时线程仍然可以正常运行，只是不再有亲和性
+    if (err != 0) {
+        Logger::warn("FiberPool: failed to bind thread {} to cpu {}: {}", thread_id, cpu, strerror(err));
+    }
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_ON_LEVEL
+    else {
+        Logger::info("FiberPool: thread {} is bound to cpu {}", thread_id, cpu);
+    }
+#endif
+}
+
+void FiberPool::run_task(EventManager* context_ptr, Fiber* tsk_ptr) {
+    MYRPC_ASSERT(tsk_ptr->GetStatus() != Fiber::ERROR);
+    // 阻塞的协程只有在等待的事件完成后才会被放入任务队列（例如RunBlockingIO），因此同样恢复执行
+    if (tsk_ptr->GetStatus() == Fiber::READY || tsk_ptr->GetStatus() == Fiber::BLOCKED) { // 如果任务已就绪，那么执行任务
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
-                Logger::debug("Thread: {}, Fiber: {} is ready to run #1", thread_id, tsk_ptr->GetId());
+        Logger::debug("Thread: {}, Fiber: {} is ready to run #1", now_thread_id, tsk_ptr->GetId());
 #endif
-                // 任务已就绪，恢复任务执行
-                auto ret_val = tsk_ptr->Resume();
+        // 任务已就绪，恢复任务执行
+        auto ret_val = tsk_ptr->Resume();
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
-                Logger::debug("Thread: {}, Fiber: {} is swapped out #1, return value:{}, status:{}", thread_id,
-                              tsk_ptr->GetId(), ret_val, tsk_ptr->GetStatus());
+        Logger::debug("Thread: {}, Fiber: {} is swapped out #1, return value:{}, status:{}", now_thread_id,
+                      tsk_ptr->GetId(), ret_val, tsk_ptr->GetStatus());
 #endif
-                // 任务让出CPU，等待下次被调度
-                auto status = tsk_ptr->GetStatus();
-                if(status == Fiber::READY) {
-                    if(!context_ptr->m_task_queue.TryPush(tsk_ptr_from_q)){
-                        MYRPC_CRITIAL_ERROR("Task queue is full!");
-                    }
-                }
-                else if(status == Fiber::BLOCKED){
-                    delete tsk_ptr_from_q;
-                }
-                else{
+        // 任务让出CPU，等待下次被调度
+        auto status = tsk_ptr->GetStatus();
+        if(status == Fiber::READY) {
+            context_ptr->schedule(tsk_ptr);
+        }
+        else if(status == Fiber::BLOCKED){
+            // 阻塞的协程由等待的IO事件持有引用
+            tsk_ptr->Release();
+        }
+        else{
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
-                    Logger::debug("Thread: {}, Fiber: {} is going to delete", thread_id, tsk_ptr->GetId());
+            Logger::debug("Thread: {}, Fiber: {} is going to delete", now_thread_id, tsk_ptr->GetId());
 #endif
-                    delete tsk_ptr_from_q;
-                    --m_tasks_cnt;
-                }
-                tsk_ptr_from_q = nullptr;
-            }else if (tsk_ptr->GetStatus() == Fiber::TERMINAL) {
-                    // 协程执行完成，从任务队列中删除
+            tsk_ptr->Release();
+            --m_tasks_cnt;
+        }
+    }else if (tsk_ptr->GetStatus() == Fiber::TERMINAL) {
+        // 协程执行完成，从任务队列中删除
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
-                Logger::debug("Thread: {}, Fiber: {} is going to delete", thread_id, tsk_ptr->GetId());
+        Logger::debug("Thread: {}, Fiber: {} is going to delete", now_thread_id, tsk_ptr->GetId());
 #endif
-                delete tsk_ptr_from_q;
-                tsk_ptr_from_q = nullptr;
-                --m_tasks_cnt;
-            }else{
-                // 该分支不应该被执行
-                MYRPC_CRITIAL_ERROR("Internal Error!");
-            }
+        tsk_ptr->Release();
+        --m_tasks_cnt;
+    }else{
+        // 该分支不应该被执行
+        MYRPC_CRITIAL_ERROR("Internal Error!");
+    }
+}
+
+bool FiberPool::steal(int thread_id) {
+    static thread_local int steal_start = 0;
+
+    auto context_ptr = m_threads_context_ptr[thread_id];
+    ++steal_start;
+    for (int i = 0; i < m_threads_num; i++) {
+        int victim_id = (steal_start + i) % m_threads_num;
+        if (victim_id == thread_id) continue;
+
+        auto victim = m_threads_context_ptr[victim_id];
+        auto size = victim->m_stealable_queue.Size();
+        if (size == 0) continue;
+
+        // 一次窃取被窃取线程积压协程的一半
+        unsigned long n_steal = (size + 1) / 2, stolen = 0;
+        Fiber* fiber;
+        while (stolen < n_steal && victim->m_stealable_queue.TryPop(fiber)) {
+            context_ptr->schedule(fiber);
+            ++stolen;
+        }
+        if (stolen > 0) {
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_FIBER_POOL_LEVEL
+            Logger::debug("Thread: {} stole {} fibers from thread {}", thread_id, stolen, victim_id);
+#endif
+            context_ptr->m_steal_count.fetch_add(1, std::memory_order_relaxed);
+            context_ptr->m_stolen_fiber_count.fetch_add(stolen, std::memory_order_relaxed);
+            return true;
         }
+    }
+    context_ptr->m_steal_fail_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void FiberPool::publish_tasks(int thread_id) {
+    auto context_ptr = m_threads_context_ptr[thread_id];
+    auto n = context_ptr->m_local_queue.Size() / 2;
+    Fiber* fiber;
+    for (size_t i = 0; i < n && context_ptr->m_local_queue.TryPop(fiber); i++) {
+        if (fiber->IsPinned()) context_ptr->schedule(fiber);
+        else context_ptr->m_stealable_queue.Push(fiber);
+    }
+    if (!context_ptr->m_stealable_queue.Empty()) wake_idle_thread(thread_id);
+}
+
+void FiberPool::wake_idle_thread(int thread_id) {
+    for (int i = 1; i < m_threads_num; i++) {
+        if (wakeup((thread_id + i) % m_threads_num)) return;
+    }
+}
 
-        // 2. 处理epoll事件
-        context_ptr->WaitEvent(now_thread_id);
+FiberPool::Statistics FiberPool::GetStatistics(int thread_id) const {
+    Statistics stat;
+    for (int i = 0; i < (int)m_threads_context_ptr.size(); i++) {
+        if (thread_id != -1 && thread_id != i) continue;
+        auto context_ptr = m_threads_context_ptr[i];
+        stat.steal_count += context_ptr->m_steal_count.load(std::memory_order_relaxed);
+        stat.stolen_fiber_count += context_ptr->m_stolen_fiber_count.load(std::memory_order_relaxed);
+        stat.steal_fail_count += context_ptr->m_steal_fail_count.load(std::memory_order_relaxed);
+        stat.wakeup_count += context_ptr->m_wakeup_count.load(std::memory_order_relaxed);
+        stat.spin_count += context_ptr->m_spin_count.load(std::memory_order_relaxed);
+        stat.spin_hit_count += context_ptr->m_spin_hit_count.load(std::memory_order_relaxed);
+        stat.park_count += context_ptr->m_park_count.load(std::memory_order_relaxed);
+        auto queue_stat = context_ptr->m_stealable_queue.GetStatistics();
+        stat.overflow_count += queue_stat.overflow_count;
+        stat.overflow_size += queue_stat.overflow_size;
+        stat.overflow_peak_size += queue_stat.overflow_peak_size;
     }
+    return stat;
 }
 
 void FiberPool::Wait() {
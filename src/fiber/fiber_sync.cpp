@@ -1,20 +1,17 @@
 #include "fiber/fiber_sync.h"
 #include "fiber/fiber_pool.h"
+#include "arch.h"
 
-#include <sys/eventfd.h>
-#include <fcntl.h>
-#include <unordered_set>
+#include <sched.h>
+#include <chrono>
+#include <mutex>
 
 using namespace MyRPC;
 using namespace MyRPC::FiberSync;
 
 static std::atomic<int> mutex_count = 0;
 
-// Mutex id  同一个线程中是否有协程在等待获得锁
-static thread_local std::unordered_set<int> wait_for_acquire_mutex_set;
-
-
-Mutex::Mutex(){
+Mutex::Mutex(Mode mode, int spin_count): m_mode(mode), m_spin_count(spin_count) {
 
     m_mutex_id = ++mutex_count;
 
@@ -24,29 +21,48 @@ Mutex::Mutex(){
 }
 
 Mutex::~Mutex() {
+    // 协程池被强制关闭时可能仍有协程在等待，这些协程不会再被唤醒
+    if (!m_wait_queue.Empty()) Logger::warn("Mutex id: {} is destroyed with waiting fibers", m_mutex_id);
 
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_LOCK_LEVEL
     Logger::debug("Mutex id: {} closed", m_mutex_id);
 #endif
 }
 
-void Mutex::lock() {
-    // 以trylock方式尝试获得锁，如果获得锁失败，则阻塞等待
-    while(!tryLock()){ // trylock失败
-        // 在成功获得锁之前阻塞自己
-        m_wait_queue_lock.lock();
-        auto lock_id = m_lock_id.fetch_add(1);
-        m_wait_queue.push(std::make_pair(lock_id, FiberPool::GetCurrentThreadId()));
+bool Mutex::wait() {
+    std::unique_lock<SpinLock> lock(m_wait_queue_lock);
+    // 先增加等待者数量再重新尝试获得锁，与unlock中先释放锁再检查等待者数量配对，保证两者至少有一方看到对方
+    ++m_waiters;
+    if (tryLock()) {
+        --m_waiters;
+        return false;
+    }
+    m_wait_queue.Push(FiberPool::PrepareBlock());
+    lock.unlock();
 
-        do{
-            m_wait_queue_lock.unlock();
-            Fiber::Suspend(); // 切换到其他协程
-            m_wait_queue_lock.lock();
-        }while(m_wait_queue.front().first != lock_id);
+    Fiber::Block();
+    return true;
+}
 
-        m_wait_queue.pop();
+void Mutex::lock() {
+    // 阻塞之前先自旋尝试获得锁
+    bool acquired = tryLock();
+    for (int i = 0; !acquired && i < m_spin_count; i++) {
+        MYRPC_PAUSE;
+        acquired = tryLock();
+    }
 
-        m_wait_queue_lock.unlock();
+    if (!acquired) {
+        if (FiberPool::GetThis() == nullptr || Fiber::GetCurrentId() == 0) {
+            // 不在协程池中，无法阻塞
+            while (!tryLock()) sched_yield();
+        } else if (m_mode == HANDOFF) {
+            // 被唤醒时锁已经交给了当前协程
+            wait();
+        } else {
+            // 被唤醒后重新竞争锁，失败时重新加入等待队列
+            while (wait() && !tryLock());
+        }
     }
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_LOCK_LEVEL
     Logger::debug("Thread: {}, Fiber: {} has acquired a lock, mutex id: {}", FiberPool::GetCurrentThreadId(),
@@ -58,18 +74,294 @@ void Mutex::lock() {
 void Mutex::unlock() {
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_LOCK_LEVEL
     _debug_lock_owner = -10;
-#endif
-
-    m_lock.clear(std::memory_order_release); // 清除锁标志
-#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_LOCK_LEVEL
     Logger::debug("Thread: {}, Fiber: {} has released a lock, mutex id: {}", FiberPool::GetCurrentThreadId(),
                   Fiber::GetCurrentId(), m_mutex_id);
 #endif
-    m_wait_queue_lock.lock();
+    Fiber* next = nullptr;
+    if (m_mode == HANDOFF) {
+        // 有等待者时不释放锁，直接交给队首的协程
+        std::lock_guard<SpinLock> lock(m_wait_queue_lock);
+        if (m_wait_queue.TryPop(next)) --m_waiters;
+        else m_lock.clear(std::memory_order_seq_cst);
+    } else {
+        m_lock.clear(std::memory_order_seq_cst); // 清除锁标志
+        if (m_waiters.load(std::memory_order_seq_cst) == 0) return;
+
+        std::lock_guard<SpinLock> lock(m_wait_queue_lock);
+        if (m_wait_queue.TryPop(next)) --m_waiters;
+    }
+
+    // 只唤醒一个等待的协程
+    if (next) FiberPool::Wake(next);
+}
+
+RWMutex::ReaderSlot RWMutex::s_reader_table[RWMutex::READER_TABLE_SIZE];
+
+static int64_t get_steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RWMutex::~RWMutex() {
+    if (!m_read_waiters.Empty() || !m_write_waiters.Empty()) {
+        Logger::warn("RWMutex is destroyed with waiting fibers");
+    }
+}
+
+int64_t RWMutex::reader_id() {
+    auto id = Fiber::GetCurrentId();
+    if (id != 0) return id;
+
+    static std::atomic<int64_t> thread_count = 0;
+    static thread_local int64_t thread_reader_id = -(++thread_count);
+    return thread_reader_id;
+}
+
+RWMutex::ReaderSlot& RWMutex::get_slot(int64_t id) {
+    // 混合锁的地址和读者id，同一个读者持有的不同锁、同一个锁的不同读者分散到不同的槽位
+    uint64_t h = ((uint64_t)(uintptr_t)this >> 4) ^ ((uint64_t)id * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 32;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return s_reader_table[h >> (64 - READER_TABLE_BITS)];
+}
+
+void RWMutex::lock_shared() {
+    if (m_reader_bias.load(std::memory_order_acquire)) {
+        auto id = reader_id();
+        auto& slot = get_slot(id);
+        RWMutex* expected = nullptr;
+        if (slot.m_lock.compare_exchange_strong(expected, this, std::memory_order_seq_cst)) {
+            slot.m_owner.store(id, std::memory_order_relaxed);
+            // 占用槽位之后再检查偏向，与revoke_bias中先撤销偏向再扫描读者表配对
+            if (m_reader_bias.load(std::memory_order_seq_cst)) return;
+            slot.m_owner.store(0, std::memory_order_relaxed);
+            slot.m_lock.store(nullptr, std::memory_order_release);
+        }
+    }
+    lock_shared_slow();
+}
+
+void RWMutex::unlock_shared() {
+    auto id = reader_id();
+    auto& slot = get_slot(id);
+    if (slot.m_lock.load(std::memory_order_relaxed) == this && slot.m_owner.load(std::memory_order_relaxed) == id) {
+        slot.m_owner.store(0, std::memory_order_relaxed);
+        slot.m_lock.store(nullptr, std::memory_order_release);
+        return;
+    }
+    unlock_shared_slow();
+}
+
+void RWMutex::lock_shared_slow() {
+    std::unique_lock<SpinLock> lock(m_state_lock);
+    // 写者优先：有写者持有或等待时，读者阻塞
+    while (m_writer || !m_write_waiters.Empty()) {
+        auto fiber = FiberPool::PrepareBlock();
+        if (fiber == nullptr) {
+            // 不在协程池中，无法阻塞
+            lock.unlock();
+            sched_yield();
+            lock.lock();
+            continue;
+        }
+        m_read_waiters.Push(fiber);
+        lock.unlock();
+        Fiber::Block(); // 被唤醒时已经获得了读锁
+        return;
+    }
+    ++m_readers;
+    lock.unlock();
+
+    // 持有读锁时没有写者，撤销偏向后经过一段时间可以重新开启
+    if (!m_reader_bias.load(std::memory_order_relaxed) &&
+        get_steady_ns() >= m_inhibit_until.load(std::memory_order_relaxed)) {
+        m_reader_bias.store(true, std::memory_order_release);
+    }
+}
+
+void RWMutex::unlock_shared_slow() {
+    Fiber* next = nullptr;
+    {
+        std::lock_guard<SpinLock> lock(m_state_lock);
+        // 最后一个读者将锁直接交给等待的写者
+        if (--m_readers == 0 && m_write_waiters.TryPop(next)) m_writer = true;
+    }
+    if (next) FiberPool::Wake(next);
+}
+
+void RWMutex::lock() {
+    {
+        std::unique_lock<SpinLock> lock(m_state_lock);
+        while (m_writer || m_readers > 0) {
+            auto fiber = FiberPool::PrepareBlock();
+            if (fiber == nullptr) {
+                lock.unlock();
+                sched_yield();
+                lock.lock();
+                continue;
+            }
+            m_write_waiters.Push(fiber);
+            lock.unlock();
+            Fiber::Block(); // 被唤醒时已经获得了写锁
+            break;
+        }
+        if (lock.owns_lock()) m_writer = true;
+    }
+    revoke_bias();
+}
+
+void RWMutex::unlock() {
+    Fiber* writer = nullptr;
+    LocalTaskQueue<Fiber> readers;
+    {
+        std::lock_guard<SpinLock> lock(m_state_lock);
+        Fiber* fiber;
+        if (!m_read_waiters.Empty()) {
+            // 写者释放锁时，唤醒在此期间等待的所有读者，避免读者饥饿
+            m_writer = false;
+            while (m_read_waiters.TryPop(fiber)) {
+                ++m_readers;
+                readers.Push(fiber);
+            }
+        } else if (!m_write_waiters.TryPop(writer)) {
+            m_writer = false;
+        }
+    }
+    Fiber* fiber;
+    while (readers.TryPop(fiber)) FiberPool::Wake(fiber);
+    if (writer) FiberPool::Wake(writer);
+}
+
+void RWMutex::revoke_bias() {
+    if (!m_reader_bias.load(std::memory_order_relaxed)) return;
+
+    auto start = get_steady_ns();
+    m_reader_bias.store(false, std::memory_order_seq_cst);
+    for (auto& slot: s_reader_table) {
+        // 等待通过偏向路径持有锁的读者释放，读者可能与写者在同一个线程上，因此让出CPU
+        while (slot.m_lock.load(std::memory_order_seq_cst) == this) {
+            if (Fiber::GetCurrentId() != 0) Fiber::Suspend();
+            else sched_yield();
+        }
+    }
+    // 撤销耗时越长，重新开启偏向之前等待的时间越长
+    auto now = get_steady_ns();
+    m_inhibit_until.store(now + (now - start) * INHIBIT_MULTIPLIER, std::memory_order_relaxed);
+}
+
+// 在等待队列中阻塞当前协程，阻塞前释放lock。不在协程池中时返回false，lock仍然持有
+static bool park(LocalTaskQueue<Fiber>& wait_queue, std::unique_lock<SpinLock>& lock) {
+    auto fiber = FiberPool::PrepareBlock();
+    if (fiber == nullptr) return false;
+    wait_queue.Push(fiber);
+    lock.unlock();
+    Fiber::Block();
+    return true;
+}
+
+// 阻塞直到count为0
+static void wait_zero(SpinLock& spin_lock, const int64_t& count, LocalTaskQueue<Fiber>& wait_queue) {
+    std::unique_lock<SpinLock> lock(spin_lock);
+    while (count > 0) {
+        if (park(wait_queue, lock)) return; // 只有计数为0时才会被唤醒
+        lock.unlock();
+        sched_yield();
+        lock.lock();
+    }
+}
+
+// 在锁外唤醒从等待队列中取出的协程
+static void wake_all(LocalTaskQueue<Fiber>& to_wake) {
+    Fiber* fiber;
+    while (to_wake.TryPop(fiber)) FiberPool::Wake(fiber);
+}
+
+Semaphore::~Semaphore() {
+    if (!m_wait_queue.Empty()) Logger::warn("Semaphore is destroyed with waiting fibers");
+}
+
+void Semaphore::acquire() {
+    std::unique_lock<SpinLock> lock(m_lock);
+    while (m_count <= 0) {
+        if (park(m_wait_queue, lock)) return; // 被唤醒时release已经将计数交给了当前协程
+        lock.unlock();
+        sched_yield();
+        lock.lock();
+    }
+    --m_count;
+}
+
+bool Semaphore::try_acquire() {
+    std::lock_guard<SpinLock> lock(m_lock);
+    if (m_count <= 0) return false;
+    --m_count;
+    return true;
+}
+
+void Semaphore::release(int64_t n) {
+    LocalTaskQueue<Fiber> to_wake;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        Fiber* fiber;
+        while (n > 0 && m_wait_queue.TryPop(fiber)) {
+            to_wake.Push(fiber);
+            --n;
+        }
+        m_count += n;
+    }
+    wake_all(to_wake);
+}
+
+Latch::~Latch() {
+    if (!m_wait_queue.Empty()) Logger::warn("Latch is destroyed with waiting fibers");
+}
+
+void Latch::count_down(int64_t n) {
+    LocalTaskQueue<Fiber> to_wake;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        MYRPC_ASSERT(m_count >= n);
+        m_count -= n;
+        Fiber* fiber;
+        if (m_count == 0) {
+            while (m_wait_queue.TryPop(fiber)) to_wake.Push(fiber);
+        }
+    }
+    wake_all(to_wake);
+}
+
+bool Latch::try_wait() {
+    std::lock_guard<SpinLock> lock(m_lock);
+    return m_count == 0;
+}
+
+void Latch::wait() {
+    wait_zero(m_lock, m_count, m_wait_queue);
+}
 
-    if(!m_wait_queue.empty()) {
-        FiberPool::GetThis()->Notify(m_wait_queue.front().second);
+void Latch::arrive_and_wait(int64_t n) {
+    count_down(n);
+    wait();
+}
+
+WaitGroup::~WaitGroup() {
+    if (!m_wait_queue.Empty()) Logger::warn("WaitGroup is destroyed with waiting fibers");
+}
+
+void WaitGroup::Add(int64_t delta) {
+    LocalTaskQueue<Fiber> to_wake;
+    {
+        std::lock_guard<SpinLock> lock(m_lock);
+        m_count += delta;
+        MYRPC_ASSERT(m_count >= 0);
+        Fiber* fiber;
+        if (m_count == 0) {
+            while (m_wait_queue.TryPop(fiber)) to_wake.Push(fiber);
+        }
     }
+    wake_all(to_wake);
+}
 
-    m_wait_queue_lock.unlock();
+void WaitGroup::Wait() {
+    wait_zero(m_lock, m_count, m_wait_queue);
 }
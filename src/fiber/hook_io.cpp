@@ -2,69 +2,534 @@
 #include "fiber/timeout_io.h"
 #include "logger.h"
 #include "fiber/fiber_pool.h"
+#include "fiber/fd_state.h"
 #include "macro.h"
 
+#include <chrono>
 #include <unistd.h>
 #include <dlfcn.h>
-#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <vector>
 
 namespace MyRPC{
     // 原始的系统调用入口
     // 文件系统调用
     ssize_t (*sys_read)(int fd, void *buf, size_t count) = nullptr;
     ssize_t (*sys_write)(int fd, const void *buf, size_t count) = nullptr;
+    ssize_t (*sys_readv)(int fd, const iovec *iov, int iovcnt) = nullptr;
+    ssize_t (*sys_writev)(int fd, const iovec *iov, int iovcnt) = nullptr;
     int (*sys_close)(int fd) = nullptr;
+    int (*sys_dup)(int oldfd) = nullptr;
+    int (*sys_dup2)(int oldfd, int newfd) = nullptr;
+    int (*sys_dup3)(int oldfd, int newfd, int flags) = nullptr;
 
     // socket调用
+    int (*sys_socket)(int domain, int type, int protocol) = nullptr;
+    int (*sys_socketpair)(int domain, int type, int protocol, int sv[2]) = nullptr;
     int (*sys_accept)(int sockfd, sockaddr *addr, socklen_t *addrlen) = nullptr;
     int (*sys_connect)(int sockfd, const sockaddr *addr, socklen_t addrlen) = nullptr;
     ssize_t (*sys_recv)(int sockfd, void *buf, size_t len, int flags) = nullptr;
     ssize_t (*sys_send)(int sockfd, const void *buf, size_t len, int flags) = nullptr;
+    int (*sys_accept4)(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags) = nullptr;
+    ssize_t (*sys_recvfrom)(int sockfd, void *buf, size_t len, int flags, sockaddr *src_addr, socklen_t *addrlen) = nullptr;
+    ssize_t (*sys_sendto)(int sockfd, const void *buf, size_t len, int flags, const sockaddr *dest_addr, socklen_t addrlen) = nullptr;
+    ssize_t (*sys_recvmsg)(int sockfd, msghdr *msg, int flags) = nullptr;
+    ssize_t (*sys_sendmsg)(int sockfd, const msghdr *msg, int flags) = nullptr;
+    ssize_t (*sys_sendfile)(int out_fd, int in_fd, off_t *offset, size_t count) = nullptr;
 
     namespace Initializer {
         int _hook_io_initializer = []() {
             sys_read = (ssize_t (*)(int, void *, size_t))dlsym(RTLD_NEXT, "read");
             sys_write = (ssize_t (*)(int, const void *, size_t))dlsym(RTLD_NEXT, "write");
+            sys_readv = (ssize_t (*)(int, const iovec *, int))dlsym(RTLD_NEXT, "readv");
+            sys_writev = (ssize_t (*)(int, const iovec *, int))dlsym(RTLD_NEXT, "writev");
             sys_close = (int (*)(int))dlsym(RTLD_NEXT, "close");
+            sys_dup = (int (*)(int))dlsym(RTLD_NEXT, "dup");
+            sys_dup2 = (int (*)(int, int))dlsym(RTLD_NEXT, "dup2");
+            sys_dup3 = (int (*)(int, int, int))dlsym(RTLD_NEXT, "dup3");
+
+            sys_socket = (int (*)(int, int, int))dlsym(RTLD_NEXT, "socket");
+            sys_socketpair = (int (*)(int, int, int, int *))dlsym(RTLD_NEXT, "socketpair");
 
             sys_accept = (int (*)(int, sockaddr *, socklen_t *))dlsym(RTLD_NEXT, "accept");
             sys_connect = (int (*)(int, const sockaddr *, socklen_t))dlsym(RTLD_NEXT, "connect");
             sys_send = (ssize_t (*)(int, const void *, size_t, int))dlsym(RTLD_NEXT, "send");
             sys_recv = (ssize_t (*)(int, void *, size_t, int))dlsym(RTLD_NEXT, "recv");
+            sys_accept4 = (int (*)(int, sockaddr *, socklen_t *, int))dlsym(RTLD_NEXT, "accept4");
+            sys_recvfrom = (ssize_t (*)(int, void *, size_t, int, sockaddr *, socklen_t *))dlsym(RTLD_NEXT, "recvfrom");
+            sys_sendto = (ssize_t (*)(int, const void *, size_t, int, const sockaddr *, socklen_t))dlsym(RTLD_NEXT, "sendto");
+            sys_recvmsg = (ssize_t (*)(int, msghdr *, int))dlsym(RTLD_NEXT, "recvmsg");
+            sys_sendmsg = (ssize_t (*)(int, const msghdr *, int))dlsym(RTLD_NEXT, "sendmsg");
+            sys_sendfile = (ssize_t (*)(int, int, off_t *, size_t))dlsym(RTLD_NEXT, "sendfile");
             return 0;
         }();
     }
-}// namespace MyRPC
 
-using namespace MyRPC;
+    // 通过io_uring完成IO请求。返回false表示当前无法使用io_uring（或fd是非阻塞的且还没有就绪），需要退回到epoll
+    static bool io_uring_request(ssize_t& ret, uint8_t opcode, int fd, uint64_t addr, uint32_t len,
+                                 uint64_t off, uint32_t op_flags) {
+        auto event_manager = FiberPool::GetEventManager();
+        if (event_manager == nullptr || !event_manager->IsIOUringAvailable()) return false;
 
-// 覆盖posix read函数
-extern "C" ssize_t read(int fd, void *buf, size_t count) {
-    if (enable_hook) {
+        auto res = event_manager->IOUringRequest(opcode, fd, addr, len, off, op_flags);
+        if (res == -EAGAIN) return false;
+        if (res < 0) {
+            errno = -res;
+            ret = -1;
+        } else {
+            ret = res;
+        }
+        return true;
+    }
+
+    static uint64_t get_current_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief 获得fd的类型
+     * @note 只有socket的类型从FdState的缓存中直接返回：socket的快速路径需要避免额外的系统调用，
+     *       缓存过期时（fd被绕过hook的方式关闭后复用）socket操作会返回ENOTSOCK，由stale_socket处理。
+     *       其他类型的fd之后都是慢速路径（io_uring、阻塞IO线程池、epoll），每次都用fstat重新检查，类型变化时使缓存失效
+     */
+    static uint32_t get_fd_type(int fd) {
+        auto cached = FdState::GetFlags(fd);
+        if ((cached & FdState::CHECKED) && (cached & FdState::SOCKET)) return cached;
+
+        struct stat st;
+        uint32_t type = FdState::CHECKED;
+        if (fstat(fd, &st) == 0) {
+            if (S_ISSOCK(st.st_mode)) type |= FdState::SOCKET;
+            else if (S_ISREG(st.st_mode)) type |= FdState::REGULAR_FILE;
+        }
+        const uint32_t TYPE_MASK = FdState::CHECKED | FdState::SOCKET | FdState::REGULAR_FILE;
+        if ((cached & TYPE_MASK) != type) {
+            if (cached & FdState::CHECKED) FdState::Invalidate(fd);
+            FdState::SetFlags(fd, type);
+        }
+        return type;
+    }
+
+    static bool is_socket(int fd) {
+        return get_fd_type(fd) & FdState::SOCKET;
+    }
+
+    static bool is_regular_file(int fd) {
+        return get_fd_type(fd) & FdState::REGULAR_FILE;
+    }
+
+    // socket路径返回ENOTSOCK，说明缓存的类型已经过期，使缓存失效，调用者按非socket的fd重新处理
+    static bool stale_socket(int fd, ssize_t ret) {
+        if (ret != -1 || errno != ENOTSOCK) return false;
+        FdState::Invalidate(fd);
+        return true;
+    }
+
+    /**
+     * @brief 执行普通文件的读写。普通文件总是可读写的，epoll无法等待，但读写可能因磁盘IO阻塞线程，
+     *        因此转移到协程池的阻塞IO线程池中执行，当前协程让出CPU
+     * @param io[in] 执行阻塞IO操作的函数
+     * @return 与原系统调用相同
+     * @note 无法转移时（例如不在协程池中、SHARED_STACK协程）直接在当前线程执行
+     */
+    template<class IOFunc>
+    static ssize_t file_io(IOFunc&& io) {
+        ssize_t ret = -1;
+        int err = 0;
+        auto fiber_pool = FiberPool::GetThis();
+        if (fiber_pool && fiber_pool->RunBlockingIO([&]() { ret = io(); err = errno; })) {
+            enable_hook = false;
+            errno = err;
+            return ret;
+        }
+        return io();
+    }
+
+    // fd上是否有hook函数设置的O_NONBLOCK。该标志只会设置在监听socket上，fd已经不是监听socket时说明标志位已经过期
+    static bool is_hook_nonblock(int fd) {
+        if (!(FdState::GetFlags(fd) & FdState::HOOK_NONBLOCK)) return false;
+        int listening = 0;
+        socklen_t len = sizeof(listening);
+        auto saved_errno = errno;
+        bool valid = getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) == 0 && listening;
+        errno = saved_errno;
+        if (!valid) FdState::Invalidate(fd);
+        return valid;
+    }
+
+    // 用户是否将fd设置为了非阻塞模式，只在IO操作返回EAGAIN时调用
+    static bool is_user_nonblock(int fd) {
+        if (is_hook_nonblock(fd)) return false;
+        auto saved_errno = errno;
+        int flags = fcntl(fd, F_GETFL, 0);
+        errno = saved_errno;
+        return flags != -1 && (flags & O_NONBLOCK);
+    }
+
+    // 将fd设置为非阻塞模式，并记录该模式是由hook函数设置的，对用户仍表现为阻塞
+    static void set_hook_nonblock(int fd) {
+        if (FdState::GetFlags(fd) & FdState::HOOK_NONBLOCK) return;
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags == -1 || (flags & O_NONBLOCK)) return;
+        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0) FdState::SetFlags(fd, FdState::HOOK_NONBLOCK);
+    }
+
+    // hook函数返回了新的fd，该编号上可能残留着之前被绕过hook关闭的fd的状态
+    static int new_fd(int fd) {
+        if (fd >= 0) FdState::Invalidate(fd);
+        return fd;
+    }
+
+    /**
+     * @brief 等待fd上的IO事件
+     * @param deadline[in] 超时的时刻（get_current_us()），为0表示不超时
+     * @return 0表示fd可能已经就绪，需要重新尝试IO操作；超时返回MYRPC_ERR_TIMEOUT_FLAG
+     * @note 在协程池中以边缘触发方式等待，协程让出CPU；无法等待时（例如不在协程池中）调用poll阻塞当前线程
+     */
+    static int wait_io_event(int fd, EventManager::EventType event, uint64_t deadline) {
+        useconds_t remain = 0;
+        if (deadline > 0) {
+            auto now = get_current_us();
+            if (now >= deadline) return MYRPC_ERR_TIMEOUT_FLAG;
+            remain = deadline - now;
+        }
+
+        auto event_manager = FiberPool::GetEventManager();
+        if (event_manager == nullptr || event_manager->AddEdgeTriggeredIOEvent(fd, event) != 0) {
+            pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = (event == EventManager::READ) ? POLLIN : POLLOUT;
+            pfd.revents = 0;
+            int ret;
+            do {
+                ret = poll(&pfd, 1, deadline > 0 ? (int)((remain + 999) / 1000) : -1);
+            } while (ret < 0 && errno == EINTR);
+            return ret == 0 ? MYRPC_ERR_TIMEOUT_FLAG : 0;
+        }
+
+        if (remain > 0) {
+            // IO事件和定时器事件中先发生的一个会恢复协程执行
+            event_manager->AddTimerEvent(remain);
+            Fiber::Block();
+            event_manager->RemoveTimerEvent();
+        } else {
+            Fiber::Block();
+        }
         enable_hook = false;
 
-#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-        Logger::debug("Thread: {}, Fiber: {} trying to read({}, {}, {})", FiberPool::GetCurrentThreadId(),
-                            MyRPC::Fiber::GetCurrentId(), fd, buf, count);
-#endif
-        auto err = FiberPool::GetEventManager()->AddIOEvent(fd, EventManager::READ);
+        // 等待的事件还没被触发，说明超时
+        if (event_manager->IsExistIOEvent(fd, event)) {
+            MYRPC_SYS_ASSERT(event_manager->RemoveIOEvent(fd, event) == 0);
+            return MYRPC_ERR_TIMEOUT_FLAG;
+        }
+        return 0;
+    }
+
+    // IO操作返回EAGAIN时的处理方式
+    enum class WaitMode{
+        AUTO,   // fd被用户设置为非阻塞模式时直接返回，否则等待
+        WAIT,   // 总是等待（fd的非阻塞模式是hook函数临时设置的）
+        NO_WAIT // 用户要求非阻塞（MSG_DONTWAIT），直接返回
+    };
+
+    static WaitMode get_wait_mode(int flags) {
+        return (flags & MSG_DONTWAIT) ? WaitMode::NO_WAIT : WaitMode::AUTO;
+    }
+
+    /**
+     * @brief 先以非阻塞方式执行IO操作，只有返回EAGAIN时才等待fd就绪，被唤醒后重试
+     * @param mode[in] 返回EAGAIN时的处理方式
+     * @param deadline[in] 超时的时刻，为0表示不超时
+     * @param io[in] 以非阻塞方式执行IO操作的函数
+     * @param uring[in] 返回EAGAIN后，尝试通过io_uring完成IO操作的函数，返回false表示无法使用io_uring
+     * @return 与原系统调用相同，超时返回MYRPC_ERR_TIMEOUT_FLAG
+     * @note 边缘触发的事件只在fd状态变化时通知一次，因此必须在等待之前先尝试IO操作，否则可能错过已经就绪的数据。
+     *       数据已经在缓冲区中时（例如流水线化的请求），不需要切换协程和调用epoll
+     */
+    template<class IOFunc, class UringFunc>
+    static ssize_t nonblocking_io(int fd, EventManager::EventType event, WaitMode mode, uint64_t deadline,
+                                  IOFunc&& io, UringFunc&& uring) {
+        while (true) {
+            auto n = io();
+            if (n >= 0) return n;
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            if (mode == WaitMode::NO_WAIT || (mode == WaitMode::AUTO && is_user_nonblock(fd))) return -1;
+
+            ssize_t ret;
+            if (deadline == 0 && uring(ret)) return ret;
+            if (wait_io_event(fd, event, deadline) == MYRPC_ERR_TIMEOUT_FLAG) return MYRPC_ERR_TIMEOUT_FLAG;
+        }
+    }
+
+    /**
+     * @brief 在nonblocking_io的基础上，重复执行IO操作直到len个字节全部完成（wait_all为true时）
+     * @param io[in] 执行IO操作的函数，参数为已完成的字节数
+     * @return 与原系统调用相同。已经完成了部分字节时，出错或超时都返回已完成的字节数
+     */
+    template<class IOFunc, class UringFunc>
+    static ssize_t nonblocking_io_all(int fd, EventManager::EventType event, size_t len, WaitMode mode,
+                                      bool wait_all, uint64_t deadline, IOFunc&& io, UringFunc&& uring) {
+        size_t done = 0;
+        while (true) {
+            auto n = nonblocking_io(fd, event, mode, deadline, [&]() { return io(done); },
+                                    [&](ssize_t& ret) { return uring(ret, done); });
+            if (n < 0) return done > 0 ? (ssize_t)done : n;
+            done += n;
+            if (n == 0 || !wait_all || done >= len) return done;
+        }
+    }
+
+    static uint64_t get_deadline(useconds_t ts) {
+        return ts > 0 ? get_current_us() + ts : 0;
+    }
+
+    static bool no_io_uring(ssize_t&) { return false; }
+
+    static ssize_t socket_recv(int sockfd, void *buf, size_t len, int flags, uint64_t deadline) {
+        return nonblocking_io_all(sockfd, EventManager::READ, len, get_wait_mode(flags), flags & MSG_WAITALL, deadline,
+                                  [=](size_t done) {
+            return sys_recv(sockfd, (char*)buf + done, len - done, flags | MSG_DONTWAIT);
+        }, [=](ssize_t& ret, size_t done) {
+            return io_uring_request(ret, IORING_OP_RECV, sockfd, (uint64_t)buf + done, len - done, 0, flags);
+        });
+    }
+
+    static ssize_t socket_send(int sockfd, const void *buf, size_t len, int flags, uint64_t deadline) {
+        // 阻塞的send直到全部数据发送完成才返回
+        return nonblocking_io_all(sockfd, EventManager::WRITE, len, get_wait_mode(flags), true, deadline,
+                                  [=](size_t done) {
+            return sys_send(sockfd, (const char*)buf + done, len - done, flags | MSG_DONTWAIT);
+        }, [=](ssize_t& ret, size_t done) {
+            return io_uring_request(ret, IORING_OP_SEND, sockfd, (uint64_t)buf + done, len - done, 0, flags);
+        });
+    }
+
+    static int socket_accept(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags, uint64_t deadline) {
+        // accept没有类似MSG_DONTWAIT的参数，因此将监听socket设置为非阻塞模式。
+        // io_uring对非阻塞的fd会直接返回EAGAIN，因此不使用io_uring
+        set_hook_nonblock(sockfd);
+        return new_fd(nonblocking_io(sockfd, EventManager::READ, WaitMode::AUTO, deadline, [=]() {
+            return sys_accept4(sockfd, addr, addrlen, flags);
+        }, no_io_uring));
+    }
+
+    /**
+     * @brief 临时将阻塞模式的fd设置为非阻塞模式，执行一次系统调用后立即恢复原来的模式
+     * @param flags[in] fd原来的文件状态标志
+     * @note 协程等待期间fd必须保持阻塞模式：同一fd上其他协程的阻塞IO返回EAGAIN时，
+     *       is_user_nonblock看到O_NONBLOCK会认为是用户设置的，直接返回EAGAIN而不是等待
+     */
+    template<class Func>
+    static auto with_temp_nonblock(int fd, int flags, Func&& func) {
+        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return func();
+        auto ret = func();
+        auto saved_errno = errno;
+        fcntl(fd, F_SETFL, flags);
+        errno = saved_errno;
+        return ret;
+    }
+
+    static int socket_connect(int sockfd, const sockaddr *addr, socklen_t addrlen, uint64_t deadline) {
+        int flags = fcntl(sockfd, F_GETFL, 0);
+        if (flags == -1 || (flags & O_NONBLOCK)) return sys_connect(sockfd, addr, addrlen);
+
+        // 以非阻塞方式发起连接，发起后立即恢复原来的模式，连接在后台继续进行，建立后socket可写
+        int ret = with_temp_nonblock(sockfd, flags, [=]() { return sys_connect(sockfd, addr, addrlen); });
+        if (ret != 0 && errno == EINPROGRESS) {
+            if (wait_io_event(sockfd, EventManager::WRITE, deadline) == MYRPC_ERR_TIMEOUT_FLAG) {
+                ret = MYRPC_ERR_TIMEOUT_FLAG;
+            } else {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                ret = getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (ret == 0 && err != 0) {
+                    errno = err;
+                    ret = -1;
+                }
+            }
+        }
+        return ret;
+    }
+
+    static ssize_t socket_recvfrom(int sockfd, void *buf, size_t len, int flags, sockaddr *src_addr,
+                                   socklen_t *addrlen, uint64_t deadline) {
+        // 只在第一次接收时获取对端地址
+        return nonblocking_io_all(sockfd, EventManager::READ, len, get_wait_mode(flags), flags & MSG_WAITALL, deadline,
+                                  [=](size_t done) {
+            return sys_recvfrom(sockfd, (char*)buf + done, len - done, flags | MSG_DONTWAIT,
+                                done ? nullptr : src_addr, done ? nullptr : addrlen);
+        }, [](ssize_t&, size_t) { return false; });
+    }
+
+    static ssize_t socket_sendto(int sockfd, const void *buf, size_t len, int flags, const sockaddr *dest_addr,
+                                 socklen_t addrlen, uint64_t deadline) {
+        return nonblocking_io_all(sockfd, EventManager::WRITE, len, get_wait_mode(flags), true, deadline,
+                                  [=](size_t done) {
+            return sys_sendto(sockfd, (const char*)buf + done, len - done, flags | MSG_DONTWAIT, dest_addr, addrlen);
+        }, [](ssize_t&, size_t) { return false; });
+    }
+
+    static size_t get_iovec_len(const iovec *iov, size_t iovcnt) {
+        size_t len = 0;
+        for (size_t i = 0; i < iovcnt; i++) len += iov[i].iov_len;
+        return len;
+    }
+
+    // 构造跳过了前n个字节的msghdr，剩余的iovec保存在iov中。地址和控制信息只随第一部分数据发送/接收
+    static msghdr skip_msghdr(const msghdr *msg, std::vector<iovec>& iov, size_t n) {
+        msghdr m;
+        memset(&m, 0, sizeof(m));
+        iov.clear();
+        for (size_t i = 0; i < msg->msg_iovlen; i++) {
+            auto& v = msg->msg_iov[i];
+            if (n >= v.iov_len) {
+                n -= v.iov_len;
+                continue;
+            }
+            iov.push_back({(char*)v.iov_base + n, v.iov_len - n});
+            n = 0;
+        }
+        m.msg_iov = iov.data();
+        m.msg_iovlen = iov.size();
+        return m;
+    }
+
+    static ssize_t socket_recvmsg(int sockfd, msghdr *msg, int flags, uint64_t deadline) {
+        std::vector<iovec> iov;
+        return nonblocking_io_all(sockfd, EventManager::READ, get_iovec_len(msg->msg_iov, msg->msg_iovlen),
+                                  get_wait_mode(flags), flags & MSG_WAITALL, deadline, [&](size_t done) {
+            if (done == 0) return sys_recvmsg(sockfd, msg, flags | MSG_DONTWAIT);
+            auto m = skip_msghdr(msg, iov, done);
+            return sys_recvmsg(sockfd, &m, flags | MSG_DONTWAIT);
+        }, [](ssize_t&, size_t) { return false; });
+    }
+
+    static ssize_t socket_sendmsg(int sockfd, const msghdr *msg, int flags, uint64_t deadline) {
+        // 阻塞的sendmsg直到全部数据发送完成才返回
+        std::vector<iovec> iov;
+        return nonblocking_io_all(sockfd, EventManager::WRITE, get_iovec_len(msg->msg_iov, msg->msg_iovlen),
+                                  get_wait_mode(flags), true, deadline, [&](size_t done) {
+            if (done == 0) return sys_sendmsg(sockfd, msg, flags | MSG_DONTWAIT);
+            auto m = skip_msghdr(msg, iov, done);
+            return sys_sendmsg(sockfd, &m, flags | MSG_DONTWAIT);
+        }, [](ssize_t&, size_t) { return false; });
+    }
+
+    static ssize_t socket_readv(int fd, const iovec *iov, int iovcnt, uint64_t deadline) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)iov;
+        msg.msg_iovlen = iovcnt;
+        return socket_recvmsg(fd, &msg, 0, deadline);
+    }
+
+    static ssize_t socket_writev(int fd, const iovec *iov, int iovcnt, uint64_t deadline) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec*)iov;
+        msg.msg_iovlen = iovcnt;
+        return socket_sendmsg(fd, &msg, 0, deadline);
+    }
+
+    static ssize_t socket_sendfile(int out_fd, int in_fd, off_t *offset, size_t count, uint64_t deadline) {
+        int flags = fcntl(out_fd, F_GETFL, 0);
+        if (flags == -1 || (flags & O_NONBLOCK)) return sys_sendfile(out_fd, in_fd, offset, count);
+
+        // sendfile没有类似MSG_DONTWAIT的参数，每次调用sys_sendfile时临时将socket设置为非阻塞模式
+        return nonblocking_io_all(out_fd, EventManager::WRITE, count, WaitMode::WAIT, true, deadline,
+                                  [=](size_t done) {
+            return with_temp_nonblock(out_fd, flags, [=]() { return sys_sendfile(out_fd, in_fd, offset, count - done); });
+        }, [](ssize_t&, size_t) { return false; });
+    }
+
+    // 监听socket被hook函数设置为了非阻塞模式，在协程之外调用accept时仍然需要阻塞
+    static int blocking_accept(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags) {
+        int ret;
+        while ((ret = sys_accept4(sockfd, addr, addrlen, flags)) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+               is_hook_nonblock(sockfd)) {
+            pollfd pfd{sockfd, POLLIN, 0};
+            poll(&pfd, 1, -1);
+        }
+        return new_fd(ret);
+    }
+
+    // 非socket的fd（例如管道、eventfd），等待fd就绪后调用阻塞的系统调用
+    static int wait_fd_ready(int fd, EventManager::EventType event, useconds_t ts) {
+        auto err = FiberPool::GetEventManager()->AddIOEvent(fd, event);
         if(!err){
-            Fiber::Block();
+            if(ts > 0) {
+                // 在当前线程的时间轮上添加定时器，IO事件和定时器事件中先发生的一个会恢复协程执行
+                FiberPool::GetEventManager()->AddTimerEvent(ts);
+
+                Fiber::Block();
+
+                // 若IO事件先发生，则删除还未超时的定时器
+                FiberPool::GetEventManager()->RemoveTimerEvent();
+
+                // 如果fd的事件还没被触发，说明超时
+                if (FiberPool::GetEventManager()->IsExistIOEvent(fd, event)) {
+                    MYRPC_SYS_ASSERT(FiberPool::GetEventManager()->RemoveIOEvent(fd, event) == 0);
+                    return MYRPC_ERR_TIMEOUT_FLAG;
+                }
+            }
+            else {
+                Fiber::Block();
+            }
         }
         else {
             switch (errno) {
                 case EPERM:
-                    enable_hook = true;
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-                    Logger::debug("Thread: {}, Fiber: {} trying to call a non-block read syscall",
-                                  FiberPool::GetCurrentThreadId(),
-                                  MyRPC::Fiber::GetCurrentId());
+                    Logger::debug("Thread: {}, Fiber: {} trying to call a non-block {} syscall",
+                                  FiberPool::GetCurrentThreadId(), MyRPC::Fiber::GetCurrentId(),
+                                  event == EventManager::READ ? "read" : "write");
 #endif
                     break;
                 default:
                     MYRPC_SYS_ASSERT(false);
             }
         }
+        return 0;
+    }
+}// namespace MyRPC
+
+using namespace MyRPC;
+
+// 覆盖posix read函数
+extern "C" ssize_t read(int fd, void *buf, size_t count) {
+    if (enable_hook) {
+        enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to read({}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), fd, buf, count);
+#endif
+        if (is_socket(fd)) {
+            // socket上的read等价于flags为0的recv
+            auto ret = socket_recv(fd, buf, count, 0, 0);
+            if (!stale_socket(fd, ret)) {
+                enable_hook = true;
+                return ret;
+            }
+        }
+
+        ssize_t ret;
+        if (io_uring_request(ret, IORING_OP_READ, fd, (uint64_t)buf, count, (uint64_t)-1, 0)) return ret;
+
+        if (is_regular_file(fd)) {
+            ret = file_io([=]() { return sys_read(fd, buf, count); });
+            enable_hook = true;
+            return ret;
+        }
+
+        wait_fd_ready(fd, EventManager::READ, 0);
+        enable_hook = true;
     }
     return sys_read(fd, buf, count);
 }
@@ -78,33 +543,67 @@ extern "C" ssize_t write(int fd, const void *buf, size_t count) {
         Logger::debug("Thread: {}, Fiber: {} trying to write({}, {}, {})", FiberPool::GetCurrentThreadId(),
                             MyRPC::Fiber::GetCurrentId(), fd, buf, count);
 #endif
-        auto err = FiberPool::GetEventManager()->AddIOEvent(fd, EventManager::WRITE);
-        if(!err){
-            Fiber::Block();
-        }
-        else {
-            switch (errno) {
-                case EPERM:
-                    enable_hook = true;
-#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-                    Logger::debug("Thread: {}, Fiber: {} trying to call a non-block write syscall",
-                                  FiberPool::GetCurrentThreadId(),
-                                  MyRPC::Fiber::GetCurrentId());
-#endif
-                    break;
-                default:
-                    MYRPC_SYS_ASSERT(false);
+        if (is_socket(fd)) {
+            // socket上的write等价于flags为0的send
+            auto ret = socket_send(fd, buf, count, 0, 0);
+            if (!stale_socket(fd, ret)) {
+                enable_hook = true;
+                return ret;
             }
         }
+
+        ssize_t ret;
+        if (io_uring_request(ret, IORING_OP_WRITE, fd, (uint64_t)buf, count, (uint64_t)-1, 0)) return ret;
+
+        if (is_regular_file(fd)) {
+            ret = file_io([=]() { return sys_write(fd, buf, count); });
+            enable_hook = true;
+            return ret;
+        }
+
+        wait_fd_ready(fd, EventManager::WRITE, 0);
+        enable_hook = true;
     }
     return sys_write(fd, buf, count);
 }
 
 // 覆盖posix close函数
 extern "C" int close(int fd) {
+    // fd关闭后可能被重用，增加fd的代数，使之前以边缘触发方式注册在epoll中的事件和缓存的标志位失效
+    FdState::Invalidate(fd);
     return sys_close(fd);
 }
 
+// 覆盖posix dup函数
+extern "C" int dup(int oldfd) {
+    return new_fd(sys_dup(oldfd));
+}
+
+// 覆盖posix dup2函数，newfd原来指向的文件被关闭，newfd上缓存的状态失效
+extern "C" int dup2(int oldfd, int newfd) {
+    return new_fd(sys_dup2(oldfd, newfd));
+}
+
+// 覆盖dup3函数
+extern "C" int dup3(int oldfd, int newfd, int flags) {
+    return new_fd(sys_dup3(oldfd, newfd, flags));
+}
+
+// 覆盖posix socket函数，新的socket可能复用了之前被绕过hook关闭的fd的编号
+extern "C" int socket(int domain, int type, int protocol) {
+    return new_fd(sys_socket(domain, type, protocol));
+}
+
+// 覆盖posix socketpair函数
+extern "C" int socketpair(int domain, int type, int protocol, int sv[2]) {
+    int ret = sys_socketpair(domain, type, protocol, sv);
+    if (ret == 0) {
+        new_fd(sv[0]);
+        new_fd(sv[1]);
+    }
+    return ret;
+}
+
 // 覆盖posix accept函数
 extern "C" int accept(int sockfd, sockaddr *addr, socklen_t *addrlen) {
     if (enable_hook) {
@@ -114,18 +613,12 @@ extern "C" int accept(int sockfd, sockaddr *addr, socklen_t *addrlen) {
         Logger::debug("Thread: {}, Fiber: {} trying to accept({}, {}, {})", FiberPool::GetCurrentThreadId(),
                             MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, (void*)addrlen);
 #endif
-        auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::READ);
-        if(!err){
-            Fiber::Block();
-        }
-        else {
-            switch (errno) {
-                default:
-                    MYRPC_SYS_ASSERT(false);
-            }
-        }
+        auto ret = socket_accept(sockfd, addr, addrlen, 0, 0);
+        enable_hook = true;
+        return ret;
     }
-    return sys_accept(sockfd, addr, addrlen);
+
+    return blocking_accept(sockfd, addr, addrlen, 0);
 }
 
 // 覆盖posix connect函数
@@ -138,16 +631,12 @@ extern "C" int connect(int sockfd, const sockaddr *addr, socklen_t addrlen) {
                                 MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, addrlen);
 #endif
 
-        auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::WRITE);
-        if(!err){
-            Fiber::Block();
-        }
-        else {
-            switch (errno) {
-                default:
-                    MYRPC_SYS_ASSERT(false);
-            }
-        }
+        ssize_t ret;
+        if (io_uring_request(ret, IORING_OP_CONNECT, sockfd, (uint64_t)addr, 0, addrlen, 0)) return ret;
+
+        ret = socket_connect(sockfd, addr, addrlen, 0);
+        enable_hook = true;
+        return ret;
     }
     return sys_connect(sockfd, addr, addrlen);
 }
@@ -161,16 +650,9 @@ extern "C" ssize_t recv(int sockfd, void *buf, size_t len, int flags) {
         Logger::debug("Thread: {}, Fiber: {} trying to recv({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
                             MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags);
 #endif
-        auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::READ);
-        if(!err){
-            Fiber::Block();
-        }
-        else {
-            switch (errno) {
-                default:
-                    MYRPC_SYS_ASSERT(false);
-            }
-        }
+        auto ret = socket_recv(sockfd, buf, len, flags, 0);
+        enable_hook = true;
+        return ret;
     }
     return sys_recv(sockfd, buf, len, flags);
 }
@@ -184,72 +666,202 @@ extern "C" ssize_t send(int sockfd, const void *buf, size_t len, int flags) {
         Logger::debug("Thread: {}, Fiber: {} trying to send({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
                             MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags);
 #endif
+        auto ret = socket_send(sockfd, buf, len, flags, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return sys_send(sockfd, buf, len, flags);
+}
 
-        auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::WRITE);
-        if(!err){
-            Fiber::Block();
+// 覆盖posix readv函数
+extern "C" ssize_t readv(int fd, const iovec *iov, int iovcnt) {
+    if (enable_hook) {
+        enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to readv({}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), fd, (void*)iov, iovcnt);
+#endif
+        ssize_t ret;
+        if (is_socket(fd)) {
+            // socket上的readv等价于flags为0的recvmsg
+            ret = socket_readv(fd, iov, iovcnt, 0);
+            if (!stale_socket(fd, ret)) {
+                enable_hook = true;
+                return ret;
+            }
         }
-        else {
-            switch (errno) {
-                default:
-                    MYRPC_SYS_ASSERT(false);
+        if (is_regular_file(fd)) {
+            ret = file_io([=]() { return sys_readv(fd, iov, iovcnt); });
+        } else {
+            wait_fd_ready(fd, EventManager::READ, 0);
+            ret = sys_readv(fd, iov, iovcnt);
+        }
+        enable_hook = true;
+        return ret;
+    }
+    return sys_readv(fd, iov, iovcnt);
+}
+
+// 覆盖posix writev函数
+extern "C" ssize_t writev(int fd, const iovec *iov, int iovcnt) {
+    if (enable_hook) {
+        enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to writev({}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), fd, (void*)iov, iovcnt);
+#endif
+        ssize_t ret;
+        if (is_socket(fd)) {
+            // socket上的writev等价于flags为0的sendmsg
+            ret = socket_writev(fd, iov, iovcnt, 0);
+            if (!stale_socket(fd, ret)) {
+                enable_hook = true;
+                return ret;
             }
         }
+        if (is_regular_file(fd)) {
+            ret = file_io([=]() { return sys_writev(fd, iov, iovcnt); });
+        } else {
+            wait_fd_ready(fd, EventManager::WRITE, 0);
+            ret = sys_writev(fd, iov, iovcnt);
+        }
+        enable_hook = true;
+        return ret;
     }
-    return sys_send(sockfd, buf, len, flags);
+    return sys_writev(fd, iov, iovcnt);
 }
 
-namespace MyRPC{
-    ssize_t read_timeout(int fd, void *buf, size_t count, useconds_t ts) {
-        if (enable_hook) {
-            enable_hook = false;
+// 覆盖posix accept4函数
+extern "C" int accept4(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags) {
+    if (enable_hook) {
+        enable_hook = false;
 
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-            Logger::debug("Thread: {}, Fiber: {} trying to read({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
-                          MyRPC::Fiber::GetCurrentId(), fd, buf, count, ts);
+        Logger::debug("Thread: {}, Fiber: {} trying to accept4({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, (void*)addrlen, flags);
 #endif
-            auto err = FiberPool::GetEventManager()->AddIOEvent(fd, EventManager::READ);
-            if(!err){
-                if(ts > 0) {
-                    auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        auto ret = socket_accept(sockfd, addr, addrlen, flags, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return blocking_accept(sockfd, addr, addrlen, flags);
+}
 
-                    struct itimerspec its;
-                    memset(&its, 0, sizeof(its));
-                    its.it_value.tv_sec = ts / 1000000;
-                    its.it_value.tv_nsec = (ts % 1000000) * 1000;
-                    MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
+// 覆盖posix recvfrom函数
+extern "C" ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, sockaddr *src_addr, socklen_t *addrlen) {
+    if (enable_hook) {
+        enable_hook = false;
 
-                    FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to recvfrom({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags);
+#endif
+        auto ret = socket_recvfrom(sockfd, buf, len, flags, src_addr, addrlen, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return sys_recvfrom(sockfd, buf, len, flags, src_addr, addrlen);
+}
 
-                    Fiber::Block();
+// 覆盖posix sendto函数
+extern "C" ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const sockaddr *dest_addr, socklen_t addrlen) {
+    if (enable_hook) {
+        enable_hook = false;
 
-                    FiberPool::GetEventManager()->RemoveIOEvent(timer_fd, EventManager::READ);
-                    sys_close(timer_fd);
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to sendto({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags);
+#endif
+        auto ret = socket_sendto(sockfd, buf, len, flags, dest_addr, addrlen, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return sys_sendto(sockfd, buf, len, flags, dest_addr, addrlen);
+}
+
+// 覆盖posix recvmsg函数
+extern "C" ssize_t recvmsg(int sockfd, msghdr *msg, int flags) {
+    if (enable_hook) {
+        enable_hook = false;
 
-                    // 如果fd的读事件还没被触发，说明超时
-                    if (FiberPool::GetEventManager()->IsExistIOEvent(fd, EventManager::READ)) {
-                        MYRPC_SYS_ASSERT(FiberPool::GetEventManager()->RemoveIOEvent(fd, EventManager::READ) == 0);
-                        return MYRPC_ERR_TIMEOUT_FLAG;
-                    }
-                }
-                else {
-                    Fiber::Block();
-                }
-            }
-            else {
-                switch (errno) {
-                    case EPERM:
-                        enable_hook = true;
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-                        Logger::debug("Thread: {}, Fiber: {} trying to call a non-block read syscall",
-                                      FiberPool::GetCurrentThreadId(),
-                                      MyRPC::Fiber::GetCurrentId());
+        Logger::debug("Thread: {}, Fiber: {} trying to recvmsg({}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), sockfd, (void*)msg, flags);
 #endif
-                        break;
-                    default:
-                        MYRPC_SYS_ASSERT(false);
+        auto ret = socket_recvmsg(sockfd, msg, flags, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return sys_recvmsg(sockfd, msg, flags);
+}
+
+// 覆盖posix sendmsg函数
+extern "C" ssize_t sendmsg(int sockfd, const msghdr *msg, int flags) {
+    if (enable_hook) {
+        enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to sendmsg({}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), sockfd, (void*)msg, flags);
+#endif
+        auto ret = socket_sendmsg(sockfd, msg, flags, 0);
+        enable_hook = true;
+        return ret;
+    }
+    return sys_sendmsg(sockfd, msg, flags);
+}
+
+// 覆盖posix sendfile函数
+extern "C" ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+    if (enable_hook) {
+        enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+        Logger::debug("Thread: {}, Fiber: {} trying to sendfile({}, {}, {}, {})", FiberPool::GetCurrentThreadId(),
+                            MyRPC::Fiber::GetCurrentId(), out_fd, in_fd, (void*)offset, count);
+#endif
+        ssize_t ret;
+        if (is_socket(out_fd)) {
+            ret = socket_sendfile(out_fd, in_fd, offset, count, 0);
+        } else {
+            wait_fd_ready(out_fd, EventManager::WRITE, 0);
+            ret = sys_sendfile(out_fd, in_fd, offset, count);
+        }
+        enable_hook = true;
+        return ret;
+    }
+    return sys_sendfile(out_fd, in_fd, offset, count);
+}
+
+namespace MyRPC{
+    ssize_t read_timeout(int fd, void *buf, size_t count, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to read({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), fd, buf, count, ts);
+#endif
+            ssize_t ret = 0;
+            if (is_socket(fd)) {
+                ret = socket_recv(fd, buf, count, 0, get_deadline(ts));
+                if (!stale_socket(fd, ret)) {
+                    enable_hook = true;
+                    return ret;
                 }
             }
+            if (is_regular_file(fd)) {
+                // 普通文件的读写不会超时
+                ret = file_io([=]() { return sys_read(fd, buf, count); });
+            } else if (wait_fd_ready(fd, EventManager::READ, ts) == MYRPC_ERR_TIMEOUT_FLAG) {
+                ret = MYRPC_ERR_TIMEOUT_FLAG;
+            } else {
+                ret = sys_read(fd, buf, count);
+            }
+            enable_hook = true;
+            return ret;
         }
         return sys_read(fd, buf, count);
     }
@@ -262,41 +874,11 @@ namespace MyRPC{
             Logger::debug("Thread: {}, Fiber: {} trying to accept({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
                           MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, (void*)addrlen, ts);
 #endif
-            auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::READ);
-            if(!err){
-                if(ts > 0) {
-                    auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-
-                    struct itimerspec its;
-                    memset(&its, 0, sizeof(its));
-                    its.it_value.tv_sec = ts / 1000000;
-                    its.it_value.tv_nsec = (ts % 1000000) * 1000;
-                    MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
-
-                    FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
-
-                    Fiber::Block();
-
-                    FiberPool::GetEventManager()->RemoveIOEvent(timer_fd, EventManager::READ);
-                    sys_close(timer_fd);
-
-                    // 如果sockfd的读事件还没被触发，说明超时
-                    if (FiberPool::GetEventManager()->IsExistIOEvent(sockfd, EventManager::READ)) {
-                        MYRPC_SYS_ASSERT(FiberPool::GetEventManager()->RemoveIOEvent(sockfd, EventManager::READ) == 0);
-                        return MYRPC_ERR_TIMEOUT_FLAG;
-                    }
-                } else {
-                    Fiber::Block();
-                }
-            }
-            else {
-                switch (errno) {
-                    default:
-                        MYRPC_SYS_ASSERT(false);
-                }
-            }
+            auto ret = socket_accept(sockfd, addr, addrlen, 0, get_deadline(ts));
+            enable_hook = true;
+            return ret;
         }
-        return sys_accept(sockfd, addr, addrlen);
+        return blocking_accept(sockfd, addr, addrlen, 0);
     }
 
     int connect_timeout(int sockfd, const sockaddr *addr, socklen_t addrlen, useconds_t ts) {
@@ -307,86 +889,197 @@ namespace MyRPC{
             Logger::debug("Thread: {}, Fiber: {} trying to connect({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
                           MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, addrlen, ts);
 #endif
+            auto ret = socket_connect(sockfd, addr, addrlen, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_connect(sockfd, addr, addrlen);
+    }
 
-            auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::WRITE);
-            if(!err){
-                if(ts > 0) {
-                    auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    ssize_t recv_timeout(int sockfd, void *buf, size_t len, int flags, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
 
-                    struct itimerspec its;
-                    memset(&its, 0, sizeof(its));
-                    its.it_value.tv_sec = ts / 1000000;
-                    its.it_value.tv_nsec = (ts % 1000000) * 1000;
-                    MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to recv({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags, ts);
+#endif
+            auto ret = socket_recv(sockfd, buf, len, flags, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_recv(sockfd, buf, len, flags);
+    }
 
-                    FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
+    ssize_t readv_timeout(int fd, const iovec *iov, int iovcnt, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
 
-                    Fiber::Block();
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to readv({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), fd, (void*)iov, iovcnt, ts);
+#endif
+            ssize_t ret;
+            if (is_socket(fd)) {
+                ret = socket_readv(fd, iov, iovcnt, get_deadline(ts));
+                if (!stale_socket(fd, ret)) {
+                    enable_hook = true;
+                    return ret;
+                }
+            }
+            if (is_regular_file(fd)) {
+                ret = file_io([=]() { return sys_readv(fd, iov, iovcnt); });
+            } else if (wait_fd_ready(fd, EventManager::READ, ts) == MYRPC_ERR_TIMEOUT_FLAG) {
+                ret = MYRPC_ERR_TIMEOUT_FLAG;
+            } else {
+                ret = sys_readv(fd, iov, iovcnt);
+            }
+            enable_hook = true;
+            return ret;
+        }
+        return sys_readv(fd, iov, iovcnt);
+    }
 
-                    FiberPool::GetEventManager()->RemoveIOEvent(timer_fd, EventManager::READ);
-                    sys_close(timer_fd);
+    ssize_t writev_timeout(int fd, const iovec *iov, int iovcnt, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
 
-                    // 如果sockfd的读事件还没被触发，说明超时
-                    if (FiberPool::GetEventManager()->IsExistIOEvent(sockfd, EventManager::READ)) {
-                        MYRPC_SYS_ASSERT(FiberPool::GetEventManager()->RemoveIOEvent(sockfd, EventManager::READ) == 0);
-                        return MYRPC_ERR_TIMEOUT_FLAG;
-                    }
-                }else{
-                    Fiber::Block();
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to writev({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), fd, (void*)iov, iovcnt, ts);
+#endif
+            ssize_t ret;
+            if (is_socket(fd)) {
+                ret = socket_writev(fd, iov, iovcnt, get_deadline(ts));
+                if (!stale_socket(fd, ret)) {
+                    enable_hook = true;
+                    return ret;
                 }
             }
-            else {
-                switch (errno) {
-                    default:
-                        MYRPC_SYS_ASSERT(false);
-                }
+            if (is_regular_file(fd)) {
+                ret = file_io([=]() { return sys_writev(fd, iov, iovcnt); });
+            } else if (wait_fd_ready(fd, EventManager::WRITE, ts) == MYRPC_ERR_TIMEOUT_FLAG) {
+                ret = MYRPC_ERR_TIMEOUT_FLAG;
+            } else {
+                ret = sys_writev(fd, iov, iovcnt);
             }
+            enable_hook = true;
+            return ret;
         }
-        return sys_connect(sockfd, addr, addrlen);
+        return sys_writev(fd, iov, iovcnt);
     }
 
-    ssize_t recv_timeout(int sockfd, void *buf, size_t len, int flags, useconds_t ts) {
+    int accept4_timeout(int sockfd, sockaddr *addr, socklen_t *addrlen, int flags, useconds_t ts) {
         if (enable_hook) {
             enable_hook = false;
 
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
-            Logger::debug("Thread: {}, Fiber: {} trying to recv({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+            Logger::debug("Thread: {}, Fiber: {} trying to accept4({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, (void*)addr, (void*)addrlen, flags, ts);
+#endif
+            auto ret = socket_accept(sockfd, addr, addrlen, flags, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return blocking_accept(sockfd, addr, addrlen, flags);
+    }
+
+    ssize_t recvfrom_timeout(int sockfd, void *buf, size_t len, int flags, sockaddr *src_addr, socklen_t *addrlen,
+                             useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to recvfrom({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
                           MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags, ts);
 #endif
-            auto err = FiberPool::GetEventManager()->AddIOEvent(sockfd, EventManager::READ);
-            if(!err){
-                if(ts > 0) {
-                    auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-
-                    struct itimerspec its;
-                    memset(&its, 0, sizeof(its));
-                    its.it_value.tv_sec = ts / 1000000;
-                    its.it_value.tv_nsec = (ts % 1000000) * 1000;
-                    MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
-
-                    FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
-
-                    Fiber::Block();
-
-                    FiberPool::GetEventManager()->RemoveIOEvent(timer_fd, EventManager::READ);
-                    sys_close(timer_fd);
-
-                    // 如果sockfd的读事件还没被触发，说明超时
-                    if (FiberPool::GetEventManager()->IsExistIOEvent(sockfd, EventManager::READ)) {
-                        MYRPC_SYS_ASSERT(FiberPool::GetEventManager()->RemoveIOEvent(sockfd, EventManager::READ) == 0);
-                        return MYRPC_ERR_TIMEOUT_FLAG;
-                    }
-                }else{
-                    Fiber::Block();
-                }
-            }
-            else {
-                switch (errno) {
-                    default:
-                        MYRPC_SYS_ASSERT(false);
-                }
+            auto ret = socket_recvfrom(sockfd, buf, len, flags, src_addr, addrlen, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_recvfrom(sockfd, buf, len, flags, src_addr, addrlen);
+    }
+
+    ssize_t send_timeout(int sockfd, const void *buf, size_t len, int flags, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to send({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags, ts);
+#endif
+            auto ret = socket_send(sockfd, buf, len, flags, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_send(sockfd, buf, len, flags);
+    }
+
+    ssize_t sendto_timeout(int sockfd, const void *buf, size_t len, int flags, const sockaddr *dest_addr,
+                           socklen_t addrlen, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to sendto({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, buf, len, flags, ts);
+#endif
+            auto ret = socket_sendto(sockfd, buf, len, flags, dest_addr, addrlen, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_sendto(sockfd, buf, len, flags, dest_addr, addrlen);
+    }
+
+    ssize_t recvmsg_timeout(int sockfd, msghdr *msg, int flags, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to recvmsg({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, (void*)msg, flags, ts);
+#endif
+            auto ret = socket_recvmsg(sockfd, msg, flags, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_recvmsg(sockfd, msg, flags);
+    }
+
+    ssize_t sendmsg_timeout(int sockfd, const msghdr *msg, int flags, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to sendmsg({}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), sockfd, (void*)msg, flags, ts);
+#endif
+            auto ret = socket_sendmsg(sockfd, msg, flags, get_deadline(ts));
+            enable_hook = true;
+            return ret;
+        }
+        return sys_sendmsg(sockfd, msg, flags);
+    }
+
+    ssize_t sendfile_timeout(int out_fd, int in_fd, off_t *offset, size_t count, useconds_t ts) {
+        if (enable_hook) {
+            enable_hook = false;
+
+#if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_HOOK_LEVEL
+            Logger::debug("Thread: {}, Fiber: {} trying to sendfile({}, {}, {}, {}) with timeout {}us", FiberPool::GetCurrentThreadId(),
+                          MyRPC::Fiber::GetCurrentId(), out_fd, in_fd, (void*)offset, count, ts);
+#endif
+            ssize_t ret;
+            if (is_socket(out_fd)) {
+                ret = socket_sendfile(out_fd, in_fd, offset, count, get_deadline(ts));
+            } else if (wait_fd_ready(out_fd, EventManager::WRITE, ts) == MYRPC_ERR_TIMEOUT_FLAG) {
+                ret = MYRPC_ERR_TIMEOUT_FLAG;
+            } else {
+                ret = sys_sendfile(out_fd, in_fd, offset, count);
             }
+            enable_hook = true;
+            return ret;
         }
-        return sys_recv(sockfd, buf, len, flags);
+        return sys_sendfile(out_fd, in_fd, offset, count);
     }
 }// namespace MyRPC
@@ -5,7 +5,6 @@
 
 #include <unistd.h>
 #include <dlfcn.h>
-#include <sys/timerfd.h>
 
 
 namespace MyRPC{
@@ -14,8 +13,6 @@ namespace MyRPC{
     int (*sys_usleep)(useconds_t __useconds) = nullptr;
     int (*sys_nanosleep)(const struct timespec *__req, struct timespec *__rem) = nullptr;
 
-    extern int (*sys_close)(int fd);
-
     namespace Initializer {
         int _hook_sleep_initializer = []() {
             sys_sleep = (unsigned int (*)(unsigned int))dlsym(RTLD_NEXT, "sleep");
@@ -39,17 +36,8 @@ extern "C" unsigned int sleep (unsigned int __seconds) {
                             MyRPC::Fiber::GetCurrentId(), __seconds);
 #endif
         if(__seconds > 0) {
-            auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-
-            struct itimerspec its;
-            memset(&its, 0, sizeof(its));
-            its.it_value.tv_sec = __seconds;
-            MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
-
-            FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
-
+            FiberPool::GetEventManager()->AddTimerEvent((uint64_t)__seconds * 1000000);
             Fiber::Block();
-            sys_close(timer_fd);
         }
         enable_hook = true;
         return 0;
@@ -66,18 +54,8 @@ extern "C" int usleep (useconds_t __useconds) {
                       MyRPC::Fiber::GetCurrentId(), __useconds);
 #endif
         if(__useconds > 0) {
-            auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-
-            struct itimerspec its;
-            memset(&its, 0, sizeof(its));
-            its.it_value.tv_sec = __useconds / 1000000; // 秒
-            its.it_value.tv_nsec = (__useconds % 1000000) * 1000; // 微秒
-            MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
-
-            FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
-
+            FiberPool::GetEventManager()->AddTimerEvent(__useconds);
             Fiber::Block();
-            sys_close(timer_fd);
         }
         enable_hook = true;
         return 0;
@@ -94,17 +72,9 @@ extern "C" int nanosleep (const struct timespec *__req, struct timespec *__rem)
                       MyRPC::Fiber::GetCurrentId(), __req->tv_sec, __req->tv_nsec);
 #endif
         if(__req->tv_sec > 0 || __req->tv_nsec > 0) {
-            auto timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-
-            struct itimerspec its;
-            memset(&its, 0, sizeof(its));
-            memcpy(&its.it_value, __req, sizeof(struct timespec));
-            MYRPC_SYS_ASSERT(timerfd_settime(timer_fd, 0, &its, NULL) == 0);
-
-            FiberPool::GetEventManager()->AddIOEvent(timer_fd, EventManager::READ);
-
+            // 定时器的精度为TimingWheel::TICK_US，不足一个刻度的部分向上取整
+            FiberPool::GetEventManager()->AddTimerEvent((uint64_t)__req->tv_sec * 1000000 + (__req->tv_nsec + 999) / 1000);
             Fiber::Block();
-            sys_close(timer_fd);
         }
         if(__rem != NULL) {
             memset(__rem, 0, sizeof(struct timespec));
@@ -0,0 +1,157 @@
+#include "fiber/io_uring.h"
+#include "macro.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace MyRPC{
+
+IOUring::~IOUring() {
+    release();
+}
+
+bool IOUring::Init(unsigned entries) {
+    if(IsInitialized()) return true;
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if(m_ring_fd < 0){
+        m_ring_fd = -1;
+        return false;
+    }
+
+    if(!probe_ops()){
+        release();
+        return false;
+    }
+
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap){
+        if(m_cq_ring_size > m_sq_ring_size) m_sq_ring_size = m_cq_ring_size;
+        m_cq_ring_size = 0;
+    }
+
+    m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     m_ring_fd, IORING_OFF_SQ_RING);
+    if(m_sq_ring == MAP_FAILED){
+        m_sq_ring = nullptr;
+        release();
+        return false;
+    }
+    if(single_mmap){
+        m_cq_ring = m_sq_ring;
+    }else{
+        m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         m_ring_fd, IORING_OFF_CQ_RING);
+        if(m_cq_ring == MAP_FAILED){
+            m_cq_ring = nullptr;
+            release();
+            return false;
+        }
+    }
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = (io_uring_sqe*) mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  m_ring_fd, IORING_OFF_SQES);
+    if(m_sqes == MAP_FAILED){
+        m_sqes = nullptr;
+        release();
+        return false;
+    }
+
+    auto sq = (char*)m_sq_ring;
+    m_sq_head = (unsigned*)(sq + params.sq_off.head);
+    m_sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    m_sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sqe_tail = *m_sq_tail;
+
+    // 提交队列的下标数组固定为恒等映射，之后只需要移动队尾
+    auto sq_array = (unsigned*)(sq + params.sq_off.array);
+    for(unsigned i = 0; i < m_sq_entries; i++) sq_array[i] = i;
+
+    auto cq = (char*)m_cq_ring;
+    m_cq_head = (unsigned*)(cq + params.cq_off.head);
+    m_cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    m_cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    m_cq_entries = params.cq_entries;
+    m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+bool IOUring::probe_ops() {
+    static const int OP_NUM = 256;
+    auto probe = (io_uring_probe*) calloc(1, sizeof(io_uring_probe) + OP_NUM * sizeof(io_uring_probe_op));
+    MYRPC_ASSERT(probe != nullptr);
+
+    bool supported = syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PROBE, probe, OP_NUM) == 0;
+    if(supported){
+        for(auto op: {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_RECV, IORING_OP_SEND,
+                      IORING_OP_ACCEPT, IORING_OP_CONNECT}){
+            if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)){
+                supported = false;
+                break;
+            }
+        }
+    }
+    free(probe);
+    return supported;
+}
+
+io_uring_sqe* IOUring::GetSqe() {
+    auto head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if(m_sqe_tail - head >= m_sq_entries) return nullptr;
+
+    auto sqe = &m_sqes[m_sqe_tail & m_sq_mask];
+    ++m_sqe_tail;
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    return sqe;
+}
+
+unsigned IOUring::Pending() const {
+    return m_sqe_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+}
+
+int IOUring::Submit() {
+    // 发布已填写的提交队列项，内核在io_uring_enter中从队头开始取走
+    __atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+    auto to_submit = Pending();
+    if(to_submit == 0) return 0;
+
+    int ret;
+    do{
+        ret = syscall(__NR_io_uring_enter, m_ring_fd, to_submit, 0, 0, nullptr, 0);
+    }while(ret < 0 && errno == EINTR);
+    return ret < 0 ? -errno : ret;
+}
+
+bool IOUring::PopCqe(uint64_t& user_data, int32_t& res) {
+    auto head = *m_cq_head;
+    if(head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+    auto cqe = &m_cqes[head & m_cq_mask];
+    user_data = cqe->user_data;
+    res = cqe->res;
+    __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void IOUring::release() {
+    if(m_sqes) munmap(m_sqes, m_sqes_size);
+    if(m_cq_ring && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_ring_size);
+    if(m_sq_ring) munmap(m_sq_ring, m_sq_ring_size);
+    m_sqes = nullptr;
+    m_cq_ring = m_sq_ring = nullptr;
+    if(m_ring_fd >= 0) close(m_ring_fd);
+    m_ring_fd = -1;
+}
+
+}
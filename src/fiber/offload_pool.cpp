@@ -0,0 +1,90 @@
+#include "fiber/offload_pool.h"
+
+namespace MyRPC{
+
+OffloadPool::OffloadPool(int max_threads, int core_threads, std::chrono::milliseconds keep_alive):
+        m_max_threads(max_threads), m_core_threads(core_threads), m_keep_alive(keep_alive) {}
+
+OffloadPool::~OffloadPool() {
+    Stop();
+}
+
+void OffloadPool::Submit(Task&& task) {
+    std::vector<std::thread> exited;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        // 每个排队的任务都有一个空闲线程等待时不需要创建新线程
+        if ((int)m_tasks.size() > m_idle_threads && (int)m_threads.size() < m_max_threads) {
+            // 先占位再创建线程，新线程需要获得m_mutex之后才会访问自己的迭代器
+            auto it = m_threads.emplace(m_threads.end());
+            *it = std::thread(&OffloadPool::worker, this, it);
+        }
+        exited = take_exited_threads();
+    }
+    m_cond.notify_one();
+    for (auto& thread: exited) thread.join();
+}
+
+void OffloadPool::Stop() {
+    std::list<std::thread> threads;
+    std::vector<std::thread> exited;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        threads.swap(m_threads);
+        exited = take_exited_threads();
+    }
+    m_cond.notify_all();
+    for (auto& thread: threads) thread.join();
+    for (auto& thread: exited) thread.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = false;
+}
+
+void OffloadPool::SetAttr(int max_threads, int core_threads, std::chrono::milliseconds keep_alive) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_threads = max_threads;
+    m_core_threads = core_threads;
+    m_keep_alive = keep_alive;
+}
+
+int OffloadPool::GetThreadsNum() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_threads.size();
+}
+
+std::vector<std::thread> OffloadPool::take_exited_threads() {
+    std::vector<std::thread> exited;
+    exited.swap(m_exited_threads);
+    return exited;
+}
+
+void OffloadPool::worker(std::list<std::thread>::iterator self) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (m_tasks.empty()) {
+            // 停止前执行完所有已提交的任务
+            if (m_stopping) return;
+
+            ++m_idle_threads;
+            bool has_task = m_cond.wait_for(lock, m_keep_alive, [this]() { return m_stopping || !m_tasks.empty(); });
+            --m_idle_threads;
+            if (!has_task && (int)m_threads.size() > m_core_threads) break;
+            continue;
+        }
+
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+
+    // 空闲超时退出，由之后的Submit()或Stop()负责join
+    m_exited_threads.push_back(std::move(*self));
+    m_threads.erase(self);
+}
+
+}
@@ -0,0 +1,209 @@
+#include "fiber/stack_pool.h"
+#include "macro.h"
+
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace MyRPC{
+
+// 当前线程的协程栈内存池是否已经析构
+static thread_local bool stack_pool_destroyed = false;
+
+// 当前线程的协程栈内存池
+static thread_local StackPool stack_pool;
+
+StackPool::~StackPool() {
+    shrink();
+    stack_pool_destroyed = true;
+}
+
+StackPool *StackPool::GetThis() {
+    if(stack_pool_destroyed) return nullptr;
+    return &stack_pool;
+}
+
+size_t StackPool::GetPageSize() {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+bool StackPool::Resize(void*& stack, size_t& size, size_t new_size) {
+    auto page_size = GetPageSize();
+    new_size = (new_size + page_size - 1) & ~(page_size - 1);
+    if(new_size == 0 || new_size > GROWABLE_STACK_RESERVE - page_size) return false;
+
+    auto top = (char*)stack + size;
+    if(new_size > size){
+        // 将栈底之下的一段空间设置为可读写，物理内存在访问时才分配
+        if(mprotect(top - new_size, new_size - size, PROT_READ | PROT_WRITE) != 0) return false;
+    }else if(new_size < size){
+        // 释放多余部分的物理内存，并重新设置为不可访问
+        madvise(top - size, size - new_size, MADV_DONTNEED);
+        if(mprotect(top - size, size - new_size, PROT_NONE) != 0) return false;
+    }
+    stack = top - new_size;
+    size = new_size;
+    return true;
+}
+
+int StackPool::size_class(size_t size) {
+    size_t class_size = MIN_STACK_SIZE;
+    for(int i = 0; i < SIZE_CLASS_NUM; i++){
+        if(size <= class_size) return i;
+        class_size <<= 1;
+    }
+    return -1;
+}
+
+void* StackPool::sys_alloc(size_t& size, StackType type) {
+    if(type == GROWABLE_STACK){
+        auto page_size = GetPageSize();
+        size = (size + page_size - 1) & ~(page_size - 1);
+        if(size > GROWABLE_STACK_RESERVE - page_size) return nullptr;
+
+        // 预留整段虚拟地址空间，只有栈顶的size字节可以访问，其余部分（包括最低处的保护页）不可访问
+        auto base = (char*) mmap(nullptr, GROWABLE_STACK_RESERVE, PROT_NONE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if(base == MAP_FAILED) return nullptr;
+
+        auto stack = base + GROWABLE_STACK_RESERVE - size;
+        if(mprotect(stack, size, PROT_READ | PROT_WRITE) != 0){
+            munmap(base, GROWABLE_STACK_RESERVE);
+            return nullptr;
+        }
+        return stack;
+    }
+
+    if(type == MMAP_STACK){
+        auto page_size = GetPageSize();
+        size = (size + page_size - 1) & ~(page_size - 1);
+
+        // 多申请一页作为保护页。MAP_NORESERVE使得物理内存在第一次访问时才分配
+        auto base = (char*) mmap(nullptr, size + page_size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if(base == MAP_FAILED) return nullptr;
+
+        // 栈向低地址增长，保护页位于栈空间的最低处，栈溢出时会触发SIGSEGV而不是破坏其他内存
+        if(mprotect(base, page_size, PROT_NONE) != 0){
+            munmap(base, size + page_size);
+            return nullptr;
+        }
+        return base + page_size;
+    }
+
+    size = (size + 63) & ~(size_t)63;
+    return aligned_alloc(64, size);
+}
+
+void StackPool::sys_free(void* stack, size_t size, StackType type) {
+    if(type == GROWABLE_STACK){
+        MYRPC_SYS_ASSERT(munmap((char*)stack + size - GROWABLE_STACK_RESERVE, GROWABLE_STACK_RESERVE) == 0);
+        return;
+    }
+    if(type == MMAP_STACK){
+        auto page_size = GetPageSize();
+        MYRPC_SYS_ASSERT(munmap((char*)stack - page_size, size + page_size) == 0);
+        return;
+    }
+    free(stack);
+}
+
+void* StackPool::Alloc(size_t& size, StackType type) {
+    MYRPC_ASSERT(type != SHARED_STACK);
+    auto pool = GetThis();
+    if(pool) return pool->allocate(size, type);
+
+    // 线程退出阶段，直接向系统申请内存
+    return sys_alloc(size, type);
+}
+
+void StackPool::Free(void* stack, size_t size, StackType type) {
+    auto pool = GetThis();
+    if(pool) pool->deallocate(stack, size, type);
+    else sys_free(stack, size, type);
+}
+
+StackPool::Statistics StackPool::GetStatistics() {
+    auto pool = GetThis();
+    if(pool) return pool->m_stat;
+    return {};
+}
+
+void StackPool::Shrink() {
+    auto pool = GetThis();
+    if(pool) pool->shrink();
+}
+
+void* StackPool::allocate(size_t& size, StackType type) {
+    ++m_stat.alloc_count;
+
+    if(type != MALLOC_STACK && size < GetPageSize()) size = GetPageSize();
+
+    int cls = size_class(size);
+    if(cls < 0){
+        // 超出最大分级的协程栈不做缓存
+        ++m_stat.miss_count;
+        return sys_alloc(size, type);
+    }
+
+    size = MIN_STACK_SIZE << cls;
+    auto node = m_free_list[type][cls];
+    if(node){
+        ++m_stat.hit_count;
+        m_free_list[type][cls] = node->next;
+        --m_free_count[type][cls];
+        --m_stat.cached_count;
+        m_stat.cached_bytes -= size;
+
+        // 空闲链表的节点保存在栈顶
+        return (char*)(node + 1) - size;
+    }
+
+    ++m_stat.miss_count;
+    return sys_alloc(size, type);
+}
+
+void StackPool::deallocate(void* stack, size_t size, StackType type) {
+    ++m_stat.free_count;
+
+    int cls = size_class(size);
+    if(cls < 0 || m_free_count[type][cls] >= s_high_water_mark.load(std::memory_order_relaxed)){
+        sys_free(stack, size, type);
+        return;
+    }
+
+    MYRPC_ASSERT(size == (MIN_STACK_SIZE << cls));
+    if(type == MMAP_STACK && size > MMAP_TRIM_THRESHOLD){
+        // 大的协程栈在缓存前释放其已使用的物理页，只保留栈顶部分
+        madvise(stack, size - MMAP_TRIM_KEEP, MADV_DONTNEED);
+    }
+
+    // 空闲链表的节点保存在栈顶（高地址），栈底的内存可能已被释放
+    auto node = (FreeNode*)((char*)stack + size) - 1;
+    node->next = m_free_list[type][cls];
+    m_free_list[type][cls] = node;
+    ++m_free_count[type][cls];
+    ++m_stat.cached_count;
+    m_stat.cached_bytes += size;
+}
+
+void StackPool::shrink() {
+    for(int type = 0; type < STACK_TYPE_NUM; type++) {
+        for (int i = 0; i < SIZE_CLASS_NUM; i++) {
+            size_t size = MIN_STACK_SIZE << i;
+            auto node = m_free_list[type][i];
+            while (node) {
+                auto next = node->next;
+                sys_free((char*)(node + 1) - size, size, (StackType)type);
+                node = next;
+            }
+            m_free_list[type][i] = nullptr;
+            m_free_count[type][i] = 0;
+        }
+    }
+    m_stat.cached_count = 0;
+    m_stat.cached_bytes = 0;
+}
+
+}
@@ -0,0 +1,173 @@
+#include "fiber/timing_wheel.h"
+#include "macro.h"
+
+#include <ctime>
+
+namespace MyRPC{
+
+TimingWheel::TimingWheel(uint64_t current_tick): m_current(current_tick) {
+    for(auto& head: m_level0) list_init(&head);
+    for(auto& level: m_levels){
+        for(auto& head: level) list_init(&head);
+    }
+    list_init(&m_expired);
+}
+
+uint64_t TimingWheel::GetCurrentTick() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000) / TICK_US;
+}
+
+uint64_t TimingWheel::GetExpireTick(uint64_t timeout_us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    auto now_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    return (now_us + timeout_us + TICK_US - 1) / TICK_US;
+}
+
+void TimingWheel::Add(TimerNode* node, uint64_t expire_tick) {
+    MYRPC_ASSERT(!node->IsTimerActive());
+    node->m_timer_expire = expire_tick;
+    insert(node);
+    ++m_count;
+}
+
+void TimingWheel::Remove(TimerNode* node) {
+    if(!node->IsTimerActive()) return;
+    list_unlink(node);
+    --m_count;
+}
+
+TimerNode* TimingWheel::PopExpired() {
+    if(list_empty(&m_expired)) return nullptr;
+    auto node = m_expired.m_timer_next;
+    list_unlink(node);
+    --m_count;
+    return node;
+}
+
+void TimingWheel::Advance(uint64_t now_tick) {
+    if(m_count == 0){
+        if(m_current <= now_tick) m_current = now_tick + 1;
+        return;
+    }
+
+    while(m_current <= now_tick){
+        size_t idx = m_current & LEVEL0_MASK;
+        if(idx == 0) cascade();
+
+        // 跳过第0层中的空槽，最多跳到第0层转完一圈的位置（需要级联）
+        auto next = find_level0_slot(idx);
+        if(next != idx){
+            auto target = m_current - idx + next;
+            if(target > now_tick){
+                m_current = now_tick + 1;
+                return;
+            }
+            m_current = target;
+            continue;
+        }
+
+        m_level0_bitmap[idx / 64] &= ~(1ULL << (idx % 64));
+        list_splice(&m_level0[idx], &m_expired);
+        ++m_current;
+    }
+}
+
+void TimingWheel::ExpireAll() {
+    for(auto& head: m_level0) list_splice(&head, &m_expired);
+    for(auto& level: m_levels){
+        for(auto& head: level) list_splice(&head, &m_expired);
+    }
+    for(auto& word: m_level0_bitmap) word = 0;
+}
+
+int64_t TimingWheel::NextTimeout(uint64_t now_tick) const {
+    if(m_count == 0) return -1;
+    if(!list_empty(&m_expired)) return 0;
+
+    // m_current位于第0层的起点时，上层的定时器可能还没有级联下来
+    size_t idx = m_current & LEVEL0_MASK;
+    auto target = idx == 0 ? m_current : m_current - idx + find_level0_slot(idx);
+    return target > now_tick ? target - now_tick : 0;
+}
+
+void TimingWheel::insert(TimerNode* node) {
+    auto expire = node->m_timer_expire;
+    if(expire < m_current) expire = m_current;
+    auto delta = expire - m_current;
+    if(delta > MAX_TIMEOUT_TICK){
+        delta = MAX_TIMEOUT_TICK;
+        expire = m_current + delta;
+        node->m_timer_expire = expire;
+    }
+
+    if(delta < LEVEL0_SIZE){
+        size_t idx = expire & LEVEL0_MASK;
+        m_level0_bitmap[idx / 64] |= 1ULL << (idx % 64);
+        list_push_back(&m_level0[idx], node);
+        return;
+    }
+
+    for(int level = 1; level < LEVEL_NUM; level++){
+        if(level == LEVEL_NUM - 1 || delta < (1ULL << (LEVEL0_BITS + level * LEVEL_BITS))){
+            size_t idx = (expire >> (LEVEL0_BITS + (level - 1) * LEVEL_BITS)) & LEVEL_MASK;
+            list_push_back(&m_levels[level - 1][idx], node);
+            return;
+        }
+    }
+}
+
+void TimingWheel::cascade() {
+    for(int level = 1; level < LEVEL_NUM; level++){
+        size_t idx = (m_current >> (LEVEL0_BITS + (level - 1) * LEVEL_BITS)) & LEVEL_MASK;
+
+        TimerNode tmp;
+        list_init(&tmp);
+        list_splice(&m_levels[level - 1][idx], &tmp);
+        while(!list_empty(&tmp)){
+            auto node = tmp.m_timer_next;
+            list_unlink(node);
+            insert(node);
+        }
+
+        // 只有当前层也转完一圈时，才需要继续级联更上一层
+        if(idx != 0) break;
+    }
+}
+
+size_t TimingWheel::find_level0_slot(size_t idx) const {
+    for(size_t word = idx / 64; word < LEVEL0_SIZE / 64; word++){
+        auto bits = m_level0_bitmap[word];
+        if(word == idx / 64) bits &= ~0ULL << (idx % 64);
+        if(bits) return word * 64 + __builtin_ctzll(bits);
+    }
+    return LEVEL0_SIZE;
+}
+
+void TimingWheel::list_push_back(TimerNode* head, TimerNode* node) {
+    node->m_timer_prev = head->m_timer_prev;
+    node->m_timer_next = head;
+    head->m_timer_prev->m_timer_next = node;
+    head->m_timer_prev = node;
+}
+
+void TimingWheel::list_unlink(TimerNode* node) {
+    node->m_timer_prev->m_timer_next = node->m_timer_next;
+    node->m_timer_next->m_timer_prev = node->m_timer_prev;
+    node->m_timer_prev = node->m_timer_next = nullptr;
+}
+
+void TimingWheel::list_splice(TimerNode* from, TimerNode* to) {
+    if(list_empty(from)) return;
+    auto first = from->m_timer_next;
+    auto last = from->m_timer_prev;
+    first->m_timer_prev = to->m_timer_prev;
+    to->m_timer_prev->m_timer_next = first;
+    last->m_timer_next = to;
+    to->m_timer_prev = last;
+    list_init(from);
+}
+
+}
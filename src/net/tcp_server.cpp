@@ -61,7 +61,7 @@ void TCPServer::Start() {
 
         MYRPC_ASSERT_EXCEPTION(listen(m_listen_sock_fd, SOMAXCONN) == 0, throw SocketException("socket listen"));
         m_fiber_pool->Start();
-        m_acceptor = m_fiber_pool->Run(std::bind(&TCPServer::doAccept, this));
+        m_acceptor = m_fiber_pool->Run([this](){ doAccept(); });
 
         m_running = true;
     }
@@ -97,7 +97,7 @@ void TCPServer::doAccept() {
             else break;
         }
         Socket::ptr sock = std::make_shared<Socket>(sockfd);
-        m_fiber_pool->Run(std::bind(&TCPServer::handleConnection, this, sock));
+        m_fiber_pool->Run([this, sock](){ handleConnection(sock); });
     }
 }
 
@@ -39,6 +39,8 @@ std::string GetLocalHost() {
 
 RPCClient::RPCClient(Config::ptr config) :m_fiber_pool(std::make_shared<FiberPool>(config->GetThreadsNum())),
 m_timeout(1000*config->GetTimeout()), m_keepalive(config->GetKeepalive()), m_registry(config->GetRegistryServerAddr(), *this){
+    m_fiber_pool->SetCpuAffinity(config->GetCpuAffinity());
+
     if(config->GetLoadBalancer() == "HashLoadBalancer"){
         std::string host = GetLocalHost();
         if(!host.empty()){
@@ -58,11 +60,11 @@ void RPCClient::RegistryClientSession::handleConnect() {
 
     RPCSession proto(*m_sock, m_timeout);
 
-    FiberSync::Mutex wait_subtask_exit_mutex; // 用于等待子协程退出
-    wait_subtask_exit_mutex.lock();
+    FiberSync::WaitGroup subtask_wg; // 用于等待子协程退出
+    subtask_wg.Add(2);
     bool kill_subtask = false;
     // 开启子协程，定时发送Heartbeat包
-    m_fiber_pool->Run([this, &proto, &kill_subtask, &wait_subtask_exit_mutex](){
+    m_fiber_pool->Run([this, &proto, &kill_subtask, &subtask_wg](){
         usleep(m_keepalive * 800000);
         while(!kill_subtask){
             proto.PrepareAndSend(MESSAGE_HEARTBEAT);
@@ -73,22 +75,19 @@ void RPCClient::RegistryClientSession::handleConnect() {
 
             usleep(m_keepalive * 800000);
         }
-        wait_subtask_exit_mutex.unlock();
+        subtask_wg.Done();
     }, m_connection_handler_thread_id);
 
-    FiberSync::Mutex wait_subscribe_task_exit_mutex; // 用于等待订阅子协程退出
-    wait_subscribe_task_exit_mutex.lock();
     // 开启子协程，不断向注册服务器发送订阅消息
-    m_fiber_pool->Run([this, &kill_subtask, &wait_subscribe_task_exit_mutex, &proto, &wait_recv_queue](){
+    m_fiber_pool->Run([this, &kill_subtask, &subtask_wg, &proto, &wait_recv_queue](){
         while(!kill_subtask){
             std::unordered_set<std::string> new_service;
             {
                 std::unique_lock<SpinLock> spin_lock(m_service_queue_mutex);
-                while (!kill_subtask && m_service_queue.empty()) { // 如果没有新的服务需要被订阅，就等待直到有新的服务到来
-                    spin_lock.unlock();
-                    Fiber::Suspend();
-                    spin_lock.lock();
-                }
+                // 如果没有新的服务需要被订阅，就等待直到有新的服务到来
+                m_service_queue_cv.wait(m_service_queue_mutex, [&kill_subtask, this](){
+                    return kill_subtask || !m_service_queue.empty();
+                });
                 if(kill_subtask) break;
 
                 for(const auto & node_ptr : m_service_queue){
@@ -104,7 +103,7 @@ void RPCClient::RegistryClientSession::handleConnect() {
                          m_server_addr->GetIP(), m_server_addr->GetPort(), JsonSerializer::ToString(new_service));
 #endif
         }
-        wait_subscribe_task_exit_mutex.unlock();
+        subtask_wg.Done();
     }, m_connection_handler_thread_id);
 
     while(!IsClosing()) {
@@ -152,7 +151,7 @@ void RPCClient::RegistryClientSession::handleConnect() {
                             if(wait_range.first != wait_range.second) {
                                 for (auto wait_iter = wait_range.first; wait_iter != wait_range.second; ++wait_iter) {
                                     wait_iter->second->is_exist = true;
-                                    wait_iter->second->wait_mutex.unlock();
+                                    wait_iter->second->m_done.count_down();
                                 }
 
                                 wait_recv_queue.erase(wait_range.first, wait_range.second);
@@ -164,7 +163,7 @@ void RPCClient::RegistryClientSession::handleConnect() {
                             auto wait_range = wait_recv_queue.equal_range(service_name);
                             if(wait_range.first != wait_range.second) {
                                 for (auto wait_iter = wait_range.first; wait_iter != wait_range.second; ++wait_iter) {
-                                    wait_iter->second->wait_mutex.unlock();
+                                    wait_iter->second->m_done.count_down();
                                 }
 
                                 wait_recv_queue.erase(wait_range.first, wait_range.second);
@@ -188,17 +187,25 @@ void RPCClient::RegistryClientSession::handleConnect() {
     }
 
     do_connect_end_while:
-    kill_subtask = true;
+    {
+        std::unique_lock<SpinLock> lock(m_service_queue_mutex);
+        kill_subtask = true;
+        m_service_queue_cv.notify_all();
+    }
     m_connection_handler_thread_id = -1;
-    wait_subtask_exit_mutex.lock();
+    subtask_wg.Wait();
     m_connection_closed = true;
 
-    // 处理消息队列中未处理的消息
+    // 处理消息队列中未处理的消息，以及已经发送但没有收到回复的消息
     {
         std::unique_lock<SpinLock> lock(m_service_queue_mutex);
         for(const auto& node_ptr: m_service_queue){
-            node_ptr->wait_mutex.unlock(); // 唤醒等待协程
+            node_ptr->m_done.count_down(); // 唤醒等待协程
         }
+        m_service_queue.clear();
+    }
+    for(const auto& [service_name, node_ptr]: wait_recv_queue){
+        node_ptr->m_done.count_down();
     }
 
     if(!IsClosing()) {
@@ -212,20 +219,14 @@ void RPCClient::RegistryClientSession::handleConnect() {
 }
 
 bool RPCClient::RegistryClientSession::Query(std::string_view service_name) {
-    if(!IsClosed()) {
-        std::unique_lock<SpinLock> lock(m_service_queue_mutex);
-        bool is_queue_empty = m_service_queue.empty();
-        auto service = m_service_queue.emplace_back(std::make_shared<ServiceQueueNode>(service_name));
-        lock.unlock();
+    std::unique_lock<SpinLock> lock(m_service_queue_mutex);
+    // 在锁内检查：连接处理协程先设置m_connection_closed再在锁内清空队列，锁外检查可能在清空之后才加入队列，永远等不到结果
+    if(IsClosed()) return false;
+    auto service = m_service_queue.emplace_back(std::make_shared<ServiceQueueNode>(service_name));
+    m_service_queue_cv.notify_one();
+    lock.unlock();
 
-        if (is_queue_empty && m_connection_handler_thread_id >= 0) {
-            m_fiber_pool->Notify(m_connection_handler_thread_id);
-        }
+    service->m_done.wait(); // 等待查询结果
 
-        service->wait_mutex.lock();
-        service->wait_mutex.lock();
-
-        return service->is_exist;
-    }
-    return false;
+    return service->is_exist;
 }
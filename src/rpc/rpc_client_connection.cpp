@@ -1,6 +1,7 @@
 #include "rpc/rpc_client_connection.h"
 
 #include <shared_mutex>
+#include <queue>
 
 using namespace MyRPC;
 
@@ -11,10 +12,16 @@ RPCClientException::ErrorType RPCClientConnection::SendRecv(const StringBuffer&
     }
 
     // 发送消息到发送队列
-    m_send_queue.Emplace(new RPCQueueNode(to_send));
+    if(!m_send_queue.Send(std::make_shared<RPCQueueNode>(to_send))){
+        return RPCClientException::SERVER_CLOSED;
+    }
 
     // 从接收队列中接收消息
-    auto ret_ptr = m_recv_queue.Pop();
+    RPCQueueNode::ptr ret_ptr;
+    if(!m_recv_queue.Recv(ret_ptr)){
+        // 连接在收到回复之前被关闭
+        return RPCClientException::SERVER_CLOSED;
+    }
 
     if(ret_ptr->m_ret){
         recv = std::move(ret_ptr->m_ret.value());
@@ -22,6 +29,12 @@ RPCClientException::ErrorType RPCClientConnection::SendRecv(const StringBuffer&
     return ret_ptr->m_err;
 }
 
+void RPCClientConnection::disConnect() {
+    TCPClient::disConnect();
+    // 唤醒在发送队列上等待的连接处理协程
+    m_send_queue.Close();
+}
+
 void RPCClientConnection::handleConnect() {
     TCPClient::handleConnect();
 
@@ -33,10 +46,10 @@ void RPCClientConnection::handleConnect() {
 
     bool kill_subtask = false; // 用于杀死所有子协程
 
-    FiberSync::Mutex wait_heartbeat_task_exit_mutex; // 用于等待心跳定时发送子协程退出
-    wait_heartbeat_task_exit_mutex.lock();
+    FiberSync::WaitGroup subtask_wg; // 用于等待心跳定时发送子协程退出
+    subtask_wg.Add();
     // 开启子协程，定时发送Heartbeat包
-    m_fiber_pool->Run([this, &kill_subtask, &wait_heartbeat_task_exit_mutex](){
+    m_fiber_pool->Run([this, &kill_subtask, &subtask_wg](){
         usleep(m_keepalive * 800000);
         while(!kill_subtask){
             m_session->PrepareAndSend(MESSAGE_HEARTBEAT);
@@ -46,12 +59,13 @@ void RPCClientConnection::handleConnect() {
 #endif
             usleep(m_keepalive * 800000);
         }
-        wait_heartbeat_task_exit_mutex.unlock();
+        subtask_wg.Done();
     }, m_connection_handler_thread_id);
 
     // 从服务器中接收返回数据
     while(!IsClosing()){
-        auto node = m_send_queue.Pop(); // 从发送队列中读取要发送的数据
+        RPCQueueNode::ptr node;
+        if(!m_send_queue.Recv(node)) break; // 从发送队列中读取要发送的数据
         m_session->Send(node->m_send); // 发送数据
         auto message_type = m_session->RecvAndParseHeader();
         switch(message_type){
@@ -60,7 +74,7 @@ void RPCClientConnection::handleConnect() {
                 node->m_ret = m_session->GetContent();
 
                 // 将数据放到接收队列
-                m_recv_queue.Push(node);
+                m_recv_queue.Send(node);
                 break;
             default:
 #if MYRPC_DEBUG_LEVEL >= MYRPC_DEBUG_RPC_LEVEL
@@ -75,10 +89,12 @@ void RPCClientConnection::handleConnect() {
     // 等待子协程退出
     kill_subtask = true;
     m_connection_handler_thread_id = -1;
-    wait_heartbeat_task_exit_mutex.lock();
+    subtask_wg.Wait();
 
     m_connection_closed = true;
 
+    // 之后的调用直接返回，正在等待回复的调用者被唤醒
+    m_send_queue.Close();
     m_recv_queue.Close();
 
 
@@ -14,6 +14,7 @@ using namespace MyRPC;
 RpcRegistryServer::RpcRegistryServer(const Config::ptr& config) :TCPServer(config->GetRegistryServerAddr(),
                                                                            config->GetThreadsNum(), 1000 * config->GetTimeout()),
                                                                            m_keepalive(config->GetKeepalive()){
+    m_fiber_pool->SetCpuAffinity(config->GetCpuAffinity());
 }
 
 void RpcRegistryServer::handleConnection(const Socket::ptr& sock) {
@@ -34,19 +35,19 @@ void RpcRegistryServer::handleConnection(const Socket::ptr& sock) {
         iter_session = res.first;
     }
 
-    FiberSync::Mutex wait_subtask_exit_mutex; // 用于等待心跳检测子协程退出
-    wait_subtask_exit_mutex.lock();
+    FiberSync::WaitGroup subtask_wg; // 用于等待心跳检测子协程退出
+    subtask_wg.Add();
 
     std::atomic<bool> heartbeat_flag = {false}; // 若该变量为true，表示已接收到客户端的请求/心跳包
     std::atomic<bool> heartbeat_stopped_flag = false; // 若该变量为true，表示心跳包超时，主动关闭当前连接
 
     // 创建心跳检测子协程，用于检测心跳包是否超时，若超时则将heartbeat_stopped_flag设为true并退出
-    m_fiber_pool->Run([ this, &heartbeat_flag, &heartbeat_stopped_flag, &wait_subtask_exit_mutex](){
+    m_fiber_pool->Run([ this, &heartbeat_flag, &heartbeat_stopped_flag, &subtask_wg](){
         do{
             sleep(m_keepalive);
         }while(heartbeat_flag.exchange(false)); // 如果在m_keepalive秒内接收到心跳包，就再等待m_keepalive秒
         heartbeat_stopped_flag = true;
-        wait_subtask_exit_mutex.unlock();
+        subtask_wg.Done();
     });
 
     while (!IsStopping()) {
@@ -139,7 +140,7 @@ void RpcRegistryServer::handleConnection(const Socket::ptr& sock) {
 
     // 等待心跳检测子协程退出
     heartbeat_flag = false;
-    wait_subtask_exit_mutex.lock();
+    subtask_wg.Wait();
 }
 
 void RpcRegistryServer::handleMessageRequestSubscribe(RPCSession& proto, std::vector<decltype(m_service_subscriber_map)::iterator>& local_subscribe_service) {
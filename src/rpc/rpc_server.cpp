@@ -12,6 +12,7 @@ RPCServer::RPCServer(InetAddr::ptr bind_addr, Config::ptr config) :TCPServer(bin
                                                                              1000*config->GetTimeout()), m_keepalive(config->GetKeepalive()),
                                                                              m_registry(config->GetRegistryServerAddr(),
                                                                              m_fiber_pool, 1000*config->GetTimeout(), m_keepalive){
+    m_fiber_pool->SetCpuAffinity(config->GetCpuAffinity());
 }
 
 void RPCServer::handleConnection(const Socket::ptr &sock) {
@@ -19,19 +20,19 @@ void RPCServer::handleConnection(const Socket::ptr &sock) {
 
     RPCSession proto(*sock, m_timeout);
 
-    FiberSync::Mutex wait_subtask_exit_mutex; // 用于等待心跳检测子协程退出
-    wait_subtask_exit_mutex.lock();
+    FiberSync::WaitGroup subtask_wg; // 用于等待心跳检测子协程退出
+    subtask_wg.Add();
 
     std::atomic<bool> heartbeat_flag = {false}; // 若该变量为true，表示已接收到客户端的请求/心跳包
     std::atomic<bool> heartbeat_stopped_flag = false; // 若该变量为true，表示心跳包超时，主动关闭当前连接
 
     // 创建心跳检测子协程，用于检测心跳包是否超时，若超时则将heartbeat_stopped_flag设为true并退出
-    m_fiber_pool->Run([ this, &heartbeat_flag, &heartbeat_stopped_flag, &wait_subtask_exit_mutex](){
+    m_fiber_pool->Run([ this, &heartbeat_flag, &heartbeat_stopped_flag, &subtask_wg](){
         do{
             sleep(m_keepalive);
         }while(heartbeat_flag.exchange(false)); // 如果在m_keepalive秒内接收到心跳包，就再等待m_keepalive秒
         heartbeat_stopped_flag = true;
-        wait_subtask_exit_mutex.unlock();
+        subtask_wg.Done();
     });
 
     while (!IsStopping()) {
@@ -64,22 +65,20 @@ void RPCServer::handleConnection(const Socket::ptr &sock) {
     end_loop:
     // 等待心跳检测子协程退出
     heartbeat_flag = false;
-    wait_subtask_exit_mutex.lock();
+    subtask_wg.Wait();
 }
 
 
 void RPCServer::RegistryClientSession::handleConnect() {
     TCPClient::handleConnect();
 
-    m_connection_handler_thread_id = FiberPool::GetCurrentThreadId();
-
     RPCSession proto(*m_sock, m_timeout);
 
-    FiberSync::Mutex wait_subtask_exit_mutex; // 用于等待子协程退出
-    wait_subtask_exit_mutex.lock();
+    FiberSync::WaitGroup subtask_wg; // 用于等待子协程退出
+    subtask_wg.Add();
     bool kill_subtask = false;
     // 开启子协程，定时发送Heartbeat包
-    m_fiber_pool->Run([this, &proto, &kill_subtask, &wait_subtask_exit_mutex](){
+    m_fiber_pool->Run([this, &proto, &kill_subtask, &subtask_wg](){
         usleep(m_keepalive * 800000);
         while(!kill_subtask){
             proto.PrepareAndSend(MESSAGE_HEARTBEAT);
@@ -90,7 +89,7 @@ void RPCServer::RegistryClientSession::handleConnect() {
 
             usleep(m_keepalive * 800000);
         }
-        wait_subtask_exit_mutex.unlock();
+        subtask_wg.Done();
     }, FiberPool::GetCurrentThreadId());
 
     while(!IsClosing()) {
@@ -98,11 +97,8 @@ void RPCServer::RegistryClientSession::handleConnect() {
         std::unordered_map<std::string, uint16_t> new_service;
         {
             std::unique_lock<SpinLock> spin_lock(m_service_queue_mutex);
-            while (!IsClosing() && m_service_queue.empty()) { // 如果没有新的服务需要被注册，就等待直到有新的服务到来
-                spin_lock.unlock();
-                Fiber::Suspend();
-                spin_lock.lock();
-            }
+            // 如果没有新的服务需要被注册，就等待直到有新的服务到来
+            m_service_queue_cv.wait(m_service_queue_mutex, [this](){ return IsClosing() || !m_service_queue.empty(); });
             if(IsClosing()) break;
 
             for (const auto &service: m_service_queue) new_service.emplace(service, m_port);
@@ -130,8 +126,7 @@ void RPCServer::RegistryClientSession::handleConnect() {
 
     do_connect_end_while:
     kill_subtask = true;
-    m_connection_handler_thread_id = -1;
-    wait_subtask_exit_mutex.lock();
+    subtask_wg.Wait();
     m_connection_closed = true;
 
     if(!IsClosing()) {
@@ -146,12 +141,15 @@ void RPCServer::RegistryClientSession::handleConnect() {
 
 void RPCServer::RegistryClientSession::Update(std::string_view service_name) {
     std::unique_lock<SpinLock> lock(m_service_queue_mutex);
-    bool is_queue_empty = m_service_queue.empty();
-
     m_service_queue.emplace_back(service_name);
-    if (is_queue_empty && m_connection_handler_thread_id >= 0) {
-        m_fiber_pool->Notify(m_connection_handler_thread_id);
-    }
+    m_service_queue_cv.notify_one();
+}
+
+void RPCServer::RegistryClientSession::disConnect() {
+    TCPClient::disConnect();
+    // 唤醒等待新服务的连接处理协程
+    std::unique_lock<SpinLock> lock(m_service_queue_mutex);
+    m_service_queue_cv.notify_all();
 }
 
 void RPCServer::handleMessageRequestRPC(RPCSession& proto) {
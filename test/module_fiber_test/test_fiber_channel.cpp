@@ -0,0 +1,184 @@
+#include "fiber/channel.h"
+#include "fiber/fiber_sync.h"
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+using namespace MyRPC;
+
+#define THREADS_NUM 4
+#define PRODUCER_NUM 8
+#define CONSUMER_NUM 8
+#define ITEM_PER_PRODUCER 10000
+#define PING_PONG_ROUNDS 1000
+#define WAITER_NUM 50
+
+// 多个生产者和消费者通过有界通道传递数据，生产者结束后关闭通道，消费者取完剩余的数据后退出
+void mpmc_test(){
+    FiberPool fp(THREADS_NUM);
+    fp.Start();
+
+    Channel<int64_t, 16> ch;
+    std::atomic<int64_t> sum = 0;
+    FiberSync::WaitGroup producers, consumers;
+
+    producers.Add(PRODUCER_NUM);
+    consumers.Add(CONSUMER_NUM);
+    for(int i = 0; i < CONSUMER_NUM; i++){
+        fp.Run([&](){
+            int64_t val, local = 0;
+            while(ch.Recv(val)) local += val;
+            sum += local;
+            consumers.Done();
+        }, i % THREADS_NUM);
+    }
+    for(int i = 0; i < PRODUCER_NUM; i++){
+        fp.Run([&](){
+            for(int64_t j = 1; j <= ITEM_PER_PRODUCER; j++) MYRPC_ASSERT(ch.Send(j));
+            producers.Done();
+        }, i % THREADS_NUM);
+    }
+
+    producers.Wait();
+    ch.Close();
+    consumers.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(sum == (int64_t)PRODUCER_NUM * ITEM_PER_PRODUCER * (ITEM_PER_PRODUCER + 1) / 2);
+    MYRPC_ASSERT(!ch.Send(1));
+}
+
+// 无缓冲通道，发送者和接收者直接交接
+void unbuffered_test(){
+    FiberPool fp(2);
+    fp.Start();
+
+    Channel<int, 0> ping, pong;
+    FiberSync::WaitGroup wg;
+    wg.Add(2);
+    fp.Run([&](){
+        for(int i = 0; i < PING_PONG_ROUNDS; i++){
+            MYRPC_ASSERT(ping.Send(i));
+            int val;
+            MYRPC_ASSERT(pong.Recv(val) && val == i + 1);
+        }
+        wg.Done();
+    }, 0);
+    fp.Run([&](){
+        int val;
+        while(ping.Recv(val)) MYRPC_ASSERT(pong.Send(val + 1));
+        wg.Done();
+    }, 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ping.Close();
+    wg.Wait();
+    fp.Stop();
+
+    // 没有等待的接收者时，无缓冲通道不能不阻塞地发送
+    int val = 0;
+    Channel<int, 0> ch;
+    MYRPC_ASSERT(!ch.TrySend(val) && !ch.TryRecv(val));
+}
+
+// 协程池之外的线程也可以使用TrySend/TryRecv
+void try_test(){
+    Channel<int, 2> ch;
+    int a = 1, b = 2, c = 3, out;
+    MYRPC_ASSERT(ch.TrySend(a) && ch.TrySend(b));
+    MYRPC_ASSERT(!ch.TrySend(c) && c == 3);
+    MYRPC_ASSERT(ch.TryRecv(out) && out == 1);
+    MYRPC_ASSERT(ch.TrySend(c));
+    MYRPC_ASSERT(ch.TryRecv(out) && out == 2);
+    MYRPC_ASSERT(ch.TryRecv(out) && out == 3);
+    MYRPC_ASSERT(!ch.TryRecv(out));
+}
+
+// Select等待多个通道，支持超时
+void select_test(){
+    FiberPool fp(2);
+    fp.Start();
+
+    Channel<int, 1> ch1;
+    Channel<int, 0> ch2;
+    FiberSync::WaitGroup wg;
+    wg.Add(2);
+    fp.Run([&](){
+        int v1, v2;
+        // 两个通道都没有数据，超时返回-1
+        auto start = std::chrono::steady_clock::now();
+        MYRPC_ASSERT(Select({ch1.RecvCase(v1), ch2.RecvCase(v2)}, 20000) == -1);
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        MYRPC_ASSERT(elapsed_ms >= 19);
+
+        // 另一个线程上的协程向ch2发送数据
+        bool ok = false;
+        MYRPC_ASSERT(Select({ch1.RecvCase(v1), ch2.RecvCase(v2, &ok)}, 1000000) == 1);
+        MYRPC_ASSERT(ok && v2 == 42);
+
+        // 发送分支：ch1有空位
+        int v3 = 7;
+        MYRPC_ASSERT(Select({ch2.SendCase(v3), ch1.SendCase(v3)}) == 1);
+
+        // 通道关闭时接收分支完成，ok为false
+        ch2.Close();
+        MYRPC_ASSERT(Select({ch2.RecvCase(v2, &ok)}) == 0 && !ok);
+        wg.Done();
+    }, 0);
+    fp.Run([&](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        MYRPC_ASSERT(ch2.Send(42));
+        wg.Done();
+    }, 1);
+
+    wg.Wait();
+    fp.Stop();
+    int out;
+    MYRPC_ASSERT(ch1.TryRecv(out) && out == 7);
+}
+
+// 缓冲区满时发送者阻塞，关闭通道唤醒所有阻塞的协程
+void close_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    Channel<int, 1> full, empty;
+    int val = 0;
+    MYRPC_ASSERT(full.TrySend(val));
+    std::atomic<int> failed = 0;
+    FiberSync::WaitGroup wg;
+    wg.Add(2 * WAITER_NUM);
+    for(int i = 0; i < WAITER_NUM; i++){
+        fp.Run([&](){
+            if(!full.Send(1)) ++failed;
+            wg.Done();
+        });
+        fp.Run([&](){
+            int out;
+            if(!empty.Recv(out)) ++failed;
+            wg.Done();
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    MYRPC_ASSERT(failed == 0);
+
+    full.Close();
+    empty.Close();
+    wg.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(failed == 2 * WAITER_NUM);
+    // 关闭之前缓冲区中的数据仍然可以取出
+    MYRPC_ASSERT(full.TryRecv(val) && !full.TryRecv(val));
+}
+
+int main(){
+    mpmc_test();
+    unbuffered_test();
+    try_test();
+    select_test();
+    close_test();
+    std::cout << "channel tests passed" << std::endl;
+}
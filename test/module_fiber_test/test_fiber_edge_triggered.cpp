@@ -0,0 +1,172 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "fiber/timeout_io.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+using namespace MyRPC;
+
+#define STREAM_SIZE (4 << 20)
+#define CHUNK_SIZE 2048
+#define REUSE_ROUND 200
+
+// 大量数据分多次发送，接收方每次只读取一小部分，验证边缘触发下不会丢失就绪事件
+void stream_test(){
+    FiberPool fp(2);
+    fp.Start();
+
+    int sv[2];
+    MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    std::atomic<bool> ok = false;
+    fp.Run([fd = sv[0]](){
+        char buf[CHUNK_SIZE];
+        for(size_t sent = 0; sent < STREAM_SIZE; sent += sizeof(buf)){
+            for(size_t i = 0; i < sizeof(buf); i++) buf[i] = (char)((sent + i) % 251);
+            MYRPC_ASSERT(send(fd, buf, sizeof(buf), 0) == sizeof(buf));
+        }
+        close(fd);
+    }, 0);
+    fp.Run([fd = sv[1], &ok](){
+        char buf[500];
+        size_t received = 0;
+        ssize_t n;
+        while((n = recv(fd, buf, sizeof(buf), 0)) > 0){
+            for(ssize_t i = 0; i < n; i++) MYRPC_ASSERT(buf[i] == (char)((received + i) % 251));
+            received += n;
+        }
+        ok = (n == 0 && received == STREAM_SIZE);
+        close(fd);
+    }, 1);
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+}
+
+// fd关闭后编号被复用，之前的持久注册不能影响新的fd
+void reuse_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<int> ok_cnt = 0;
+    fp.Run([&fp, &ok_cnt](){
+        for(int r = 0; r < REUSE_ROUND; r++){
+            int sv[2];
+            MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+            // 接收方先等待，发送方之后才发送，接收方再将数据原样返回
+            fp.Run([fd = sv[1]](){
+                int val;
+                MYRPC_ASSERT(recv(fd, &val, sizeof(val), MSG_WAITALL) == sizeof(val));
+                MYRPC_ASSERT(send(fd, &val, sizeof(val), 0) == sizeof(val));
+                close(fd);
+            });
+            Fiber::Suspend();
+            MYRPC_ASSERT(send(sv[0], &r, sizeof(r), 0) == sizeof(r));
+            int val;
+            if(recv(sv[0], &val, sizeof(val), MSG_WAITALL) == sizeof(val) && val == r) ++ok_cnt;
+            close(sv[0]);
+        }
+    });
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "reuse rounds: " << ok_cnt << std::endl;
+    MYRPC_ASSERT(ok_cnt == REUSE_ROUND);
+}
+
+void timeout_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<bool> ok = false;
+    fp.Run([&ok](){
+        int sv[2];
+        MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        char buf[8];
+        MYRPC_ASSERT(recv_timeout(sv[1], buf, sizeof(buf), 0, 10000) == MYRPC_ERR_TIMEOUT_FLAG);
+        MYRPC_ASSERT(send(sv[0], "abc", 3, 0) == 3);
+        MYRPC_ASSERT(recv_timeout(sv[1], buf, sizeof(buf), 0, 10000) == 3);
+        // 超时后仍可以继续等待
+        MYRPC_ASSERT(recv_timeout(sv[1], buf, sizeof(buf), 0, 10000) == MYRPC_ERR_TIMEOUT_FLAG);
+        MYRPC_ASSERT(recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT) == -1 && errno == EAGAIN);
+        close(sv[0]);
+        close(sv[1]);
+        ok = true;
+    });
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+}
+
+// fd超出EventManager中等待表的初始大小时，等待表按需扩充
+void high_fd_test(){
+    rlimit limit;
+    MYRPC_SYS_ASSERT(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    int min_fd = EventManager::FD_TABLE_INIT_SIZE * 2;
+    if(limit.rlim_cur <= (rlim_t)min_fd + 1) {
+        limit.rlim_cur = std::min(limit.rlim_max, (rlim_t)min_fd + 16);
+        if(limit.rlim_cur <= (rlim_t)min_fd + 1 || setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+            std::cout << "skip high fd test" << std::endl;
+            return;
+        }
+    }
+
+    FiberPool fp(1);
+    fp.Start();
+
+    // socket以边缘触发方式等待，管道以水平触发方式等待
+    int sv[2], pv[2];
+    MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    MYRPC_SYS_ASSERT(pipe(pv) == 0);
+    int fds[4];
+    fds[0] = fcntl(sv[0], F_DUPFD, min_fd);
+    fds[1] = fcntl(sv[1], F_DUPFD, min_fd);
+    fds[2] = fcntl(pv[0], F_DUPFD, min_fd);
+    fds[3] = fcntl(pv[1], F_DUPFD, min_fd);
+    for(int i = 0; i < 2; i++) {
+        close(sv[i]);
+        close(pv[i]);
+    }
+    for(int i = 0; i < 4; i++) MYRPC_SYS_ASSERT(fds[i] >= min_fd);
+
+    std::atomic<bool> ok = false;
+    fp.Run([&fds, &ok](){
+        int val;
+        MYRPC_ASSERT(recv(fds[1], &val, sizeof(val), MSG_WAITALL) == sizeof(val) && val == 1);
+        MYRPC_ASSERT(read_timeout(fds[2], &val, sizeof(val), 1000000) == sizeof(val) && val == 2);
+        ok = true;
+        close(fds[1]);
+        close(fds[2]);
+    });
+    fp.Run([&fds](){
+        int val = 1;
+        usleep(10000);
+        MYRPC_ASSERT(send(fds[0], &val, sizeof(val), 0) == sizeof(val));
+        val = 2;
+        usleep(10000);
+        MYRPC_ASSERT(write(fds[3], &val, sizeof(val)) == sizeof(val));
+        close(fds[0]);
+        close(fds[3]);
+    });
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+}
+
+int main(){
+    stream_test();
+    reuse_test();
+    timeout_test();
+    high_fd_test();
+    return 0;
+}
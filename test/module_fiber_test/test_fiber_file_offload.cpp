@@ -0,0 +1,109 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+using namespace MyRPC;
+
+#define FILE_BLOCK_SIZE 1024
+#define BLOCK_NUM 256
+
+int create_temp_file(){
+    char path[] = "/tmp/myrpc_file_offload_XXXXXX";
+    int fd = mkstemp(path);
+    MYRPC_SYS_ASSERT(fd >= 0);
+    unlink(path);
+    return fd;
+}
+
+// 读写文件并校验内容
+void file_io(int fd){
+    char buf[FILE_BLOCK_SIZE];
+    for(int i = 0; i < BLOCK_NUM; i++){
+        memset(buf, i & 0xff, sizeof(buf));
+        MYRPC_ASSERT(write(fd, buf, sizeof(buf)) == sizeof(buf));
+    }
+    MYRPC_SYS_ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    for(int i = 0; i < BLOCK_NUM; i += 2){
+        char buf2[FILE_BLOCK_SIZE];
+        iovec iov[2] = {{buf, sizeof(buf)}, {buf2, sizeof(buf2)}};
+        MYRPC_ASSERT(readv(fd, iov, 2) == 2 * FILE_BLOCK_SIZE);
+        MYRPC_ASSERT((unsigned char)buf[0] == (i & 0xff) && (unsigned char)buf[FILE_BLOCK_SIZE - 1] == (i & 0xff));
+        MYRPC_ASSERT((unsigned char)buf2[0] == ((i + 1) & 0xff));
+    }
+    MYRPC_ASSERT(read(fd, buf, sizeof(buf)) == 0);
+}
+
+// 文件读写期间，同一线程上的其他协程可以继续执行
+void offload_test(EventManager::IOBackend io_backend){
+    FiberPool fp(1, io_backend);
+    fp.Start();
+
+    std::atomic<bool> done = false;
+    std::atomic<int> tick = 0, tick_during_io = 0;
+    fp.Run([&](){
+        while(!done){
+            ++tick;
+            Fiber::Suspend();
+        }
+    });
+    fp.Run([&](){
+        int fd = create_temp_file();
+        auto start = tick.load();
+        file_io(fd);
+        tick_during_io = tick - start;
+        close(fd);
+
+        // 阻塞IO线程中的错误码需要传回协程
+        int ro_fd = open("/proc/self/exe", O_RDONLY);
+        MYRPC_SYS_ASSERT(ro_fd >= 0);
+        char c = 0;
+        errno = 0;
+        MYRPC_ASSERT(write(ro_fd, &c, 1) == -1 && errno == EBADF);
+        close(ro_fd);
+        done = true;
+    });
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "ticks during file io: " << tick_during_io << std::endl;
+    MYRPC_ASSERT(tick_during_io > 0);
+}
+
+// SHARED_STACK协程和协程池外的线程直接执行文件读写
+void fallback_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<bool> ok = false;
+    fp.Run([&ok](){
+        int fd = create_temp_file();
+        file_io(fd);
+        close(fd);
+        ok = true;
+    }, -1, 0, StackPool::SHARED_STACK);
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+
+    int fd = create_temp_file();
+    file_io(fd);
+    close(fd);
+}
+
+int main(){
+    offload_test(EventManager::EPOLL_BACKEND);
+    offload_test(EventManager::IO_URING_BACKEND);
+    fallback_test();
+    std::cout << "test_fiber_file_offload passed" << std::endl;
+    return 0;
+}
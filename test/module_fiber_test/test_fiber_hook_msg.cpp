@@ -0,0 +1,248 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "fiber/timeout_io.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace MyRPC;
+
+#define VEC_NUM 4
+#define VEC_SIZE (256 << 10) // 数据总量超过socket缓冲区，writev需要分多次完成
+#define FILE_SIZE (1 << 20)
+
+static std::atomic<int> ok_cnt = 0;
+
+// writev/readv，以及sendmsg/recvmsg传递文件描述符
+void vectored_test(FiberPool& fp){
+    int sv[2];
+    MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    fp.Run([fd = sv[0]](){
+        iovec iov[VEC_NUM];
+        for(int i = 0; i < VEC_NUM; i++){
+            iov[i].iov_base = malloc(VEC_SIZE);
+            iov[i].iov_len = VEC_SIZE;
+            memset(iov[i].iov_base, 'a' + i, VEC_SIZE);
+        }
+        MYRPC_ASSERT(writev(fd, iov, VEC_NUM) == VEC_NUM * VEC_SIZE);
+        for(int i = 0; i < VEC_NUM; i++) free(iov[i].iov_base);
+
+        // 发送一个文件描述符
+        int pv[2];
+        MYRPC_SYS_ASSERT(pipe(pv) == 0);
+        char data = 'x';
+        iovec v{&data, 1};
+        char control[CMSG_SPACE(sizeof(int))];
+        memset(control, 0, sizeof(control));
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &v;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pv[1], sizeof(int));
+        MYRPC_ASSERT(sendmsg(fd, &msg, 0) == 1);
+        close(pv[1]);
+
+        // 通过传递过去的管道收到回复
+        char reply[4];
+        MYRPC_ASSERT(read(pv[0], reply, sizeof(reply)) == sizeof(reply));
+        MYRPC_ASSERT(memcmp(reply, "done", 4) == 0);
+        close(pv[0]);
+        close(fd);
+    });
+    fp.Run([fd = sv[1]](){
+        char buf[2][512];
+        size_t received = 0;
+        while(received < VEC_NUM * VEC_SIZE){
+            iovec iov[2] = {{buf[0], sizeof(buf[0])}, {buf[1], std::min(sizeof(buf[1]), VEC_NUM * VEC_SIZE - received - sizeof(buf[0]))}};
+            auto n = readv(fd, iov, 2);
+            MYRPC_ASSERT(n > 0);
+            for(ssize_t i = 0; i < n; i++){
+                MYRPC_ASSERT(((char*)buf)[i] == 'a' + (char)((received + i) / VEC_SIZE));
+            }
+            received += n;
+        }
+
+        char data;
+        iovec v{&data, 1};
+        char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &v;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        MYRPC_ASSERT(recvmsg(fd, &msg, 0) == 1 && data == 'x');
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        MYRPC_ASSERT(cmsg != nullptr && cmsg->cmsg_type == SCM_RIGHTS);
+        int pipe_fd;
+        memcpy(&pipe_fd, CMSG_DATA(cmsg), sizeof(int));
+
+        // 对端在收到回复之前不会再发送数据，超时返回
+        MYRPC_ASSERT(recvmsg_timeout(fd, &msg, 0, 10000) == MYRPC_ERR_TIMEOUT_FLAG);
+        MYRPC_ASSERT(write(pipe_fd, "done", 4) == 4);
+        close(pipe_fd);
+        close(fd);
+        ++ok_cnt;
+    });
+}
+
+// UDP上的sendto/recvfrom
+void datagram_test(FiberPool& fp){
+    int server = socket(AF_INET, SOCK_DGRAM, 0);
+    MYRPC_SYS_ASSERT(server >= 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    MYRPC_SYS_ASSERT(bind(server, (sockaddr*)&addr, sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    MYRPC_SYS_ASSERT(getsockname(server, (sockaddr*)&addr, &len) == 0);
+
+    fp.Run([server](){
+        char buf[16];
+        sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        auto n = recvfrom(server, buf, sizeof(buf), 0, (sockaddr*)&peer, &peer_len);
+        MYRPC_ASSERT(n == 4);
+        MYRPC_ASSERT(sendto(server, buf, n, 0, (sockaddr*)&peer, peer_len) == n);
+        close(server);
+    });
+    fp.Run([addr](){
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        MYRPC_SYS_ASSERT(fd >= 0);
+        usleep(10000);
+        MYRPC_ASSERT(sendto(fd, "ping", 4, 0, (sockaddr*)&addr, sizeof(addr)) == 4);
+        char buf[16];
+        MYRPC_ASSERT(recvfrom_timeout(fd, buf, sizeof(buf), 0, nullptr, nullptr, 1000000) == 4);
+        MYRPC_ASSERT(memcmp(buf, "ping", 4) == 0);
+        close(fd);
+        ++ok_cnt;
+    });
+}
+
+// 通过sendfile发送文件，文件大小超过socket缓冲区；accept4接受连接
+void sendfile_test(FiberPool& fp){
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    MYRPC_SYS_ASSERT(listen_fd >= 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    MYRPC_SYS_ASSERT(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    MYRPC_SYS_ASSERT(getsockname(listen_fd, (sockaddr*)&addr, &len) == 0);
+    MYRPC_SYS_ASSERT(listen(listen_fd, 16) == 0);
+
+    fp.Run([listen_fd](){
+        int conn = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        MYRPC_SYS_ASSERT(conn >= 0);
+        MYRPC_ASSERT(fcntl(conn, F_GETFD) & FD_CLOEXEC);
+
+        char path[] = "/tmp/myrpc_sendfile_XXXXXX";
+        int file_fd = mkstemp(path);
+        MYRPC_SYS_ASSERT(file_fd >= 0);
+        unlink(path);
+        char buf[1024];
+        for(int i = 0; i < FILE_SIZE; i += sizeof(buf)){
+            for(size_t j = 0; j < sizeof(buf); j++) buf[j] = (char)((i + j) % 251);
+            MYRPC_SYS_ASSERT(pwrite(file_fd, buf, sizeof(buf), i) == sizeof(buf));
+        }
+        off_t offset = 0;
+        MYRPC_ASSERT(sendfile(conn, file_fd, &offset, FILE_SIZE) == FILE_SIZE);
+        MYRPC_ASSERT(offset == FILE_SIZE);
+        // sendfile完成后恢复为阻塞模式
+        MYRPC_ASSERT(!(fcntl(conn, F_GETFL, 0) & O_NONBLOCK));
+        close(file_fd);
+        close(conn);
+        close(listen_fd);
+    });
+    fp.Run([addr](){
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        MYRPC_SYS_ASSERT(connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+        usleep(10000); // 让发送方先填满socket缓冲区
+        char buf[512];
+        size_t received = 0;
+        ssize_t n;
+        while((n = recv(fd, buf, sizeof(buf), 0)) > 0){
+            for(ssize_t i = 0; i < n; i++) MYRPC_ASSERT(buf[i] == (char)((received + i) % 251));
+            received += n;
+        }
+        MYRPC_ASSERT(received == FILE_SIZE);
+        close(fd);
+        ++ok_cnt;
+    });
+}
+
+// sendfile等待socket可写期间，同一socket上另一个协程阻塞的recv仍然等待数据，而不是返回EAGAIN
+void full_duplex_sendfile_test(FiberPool& fp){
+    int sv[2];
+    MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    char path[] = "/tmp/myrpc_sendfile_XXXXXX";
+    int file_fd = mkstemp(path);
+    MYRPC_SYS_ASSERT(file_fd >= 0);
+    unlink(path);
+    MYRPC_SYS_ASSERT(ftruncate(file_fd, FILE_SIZE) == 0);
+
+    auto done = std::make_shared<std::atomic<int>>(0);
+    auto finish = [sv, file_fd, done](){
+        if(++*done < 3) return;
+        close(sv[0]);
+        close(sv[1]);
+        close(file_fd);
+        ++ok_cnt;
+    };
+    fp.Run([sv, file_fd, finish](){
+        off_t offset = 0;
+        MYRPC_ASSERT(sendfile(sv[0], file_fd, &offset, FILE_SIZE) == FILE_SIZE);
+        finish();
+    });
+    fp.Run([sv, finish](){
+        char c;
+        MYRPC_ASSERT(recv(sv[0], &c, 1, 0) == 1 && c == 'x');
+        finish();
+    });
+    fp.Run([sv, finish](){
+        usleep(50000); // 让sendfile填满socket缓冲区后等待，recv也开始等待
+        MYRPC_ASSERT(write(sv[1], "x", 1) == 1);
+        char buf[512];
+        size_t received = 0;
+        ssize_t n;
+        while(received < FILE_SIZE && (n = read(sv[1], buf, sizeof(buf))) > 0) received += n;
+        MYRPC_ASSERT(received == FILE_SIZE);
+        finish();
+    });
+}
+
+int main(){
+    FiberPool fp(2);
+    fp.Start();
+
+    vectored_test(fp);
+    datagram_test(fp);
+    sendfile_test(fp);
+    full_duplex_sendfile_test(fp);
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "finished: " << ok_cnt << std::endl;
+    MYRPC_ASSERT(ok_cnt == 4);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+using namespace MyRPC;
+
+#define PAIR_NUM 50
+#define ROUND_NUM 200
+
+// 每对socket上，一个协程发送数据，另一个协程接收后原样返回
+void ping_pong(EventManager::IOBackend backend){
+    FiberPool fp(2, backend);
+    fp.Start();
+
+    std::atomic<int> uring_threads = 0;
+    for(int i = 0; i < 2; i++){
+        fp.Run([&uring_threads](){
+            if(FiberPool::GetEventManager()->GetIOBackend() == EventManager::IO_URING_BACKEND) ++uring_threads;
+        }, i);
+    }
+
+    std::atomic<int> ok_cnt = 0;
+    for(int i = 0; i < PAIR_NUM; i++){
+        int sv[2];
+        MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+        // 共享栈协程不能使用io_uring，会退回到epoll
+        auto stack_type = (i % 5 == 0) ? StackPool::SHARED_STACK : StackPool::MALLOC_STACK;
+        fp.Run([fd = sv[0], &ok_cnt](){
+            for(int r = 0; r < ROUND_NUM; r++){
+                char buf[16];
+                snprintf(buf, sizeof(buf), "ping%d", r);
+                MYRPC_ASSERT(send(fd, buf, sizeof(buf), 0) == sizeof(buf));
+                char ret[16];
+                MYRPC_ASSERT(recv(fd, ret, sizeof(ret), MSG_WAITALL) == sizeof(ret));
+                MYRPC_ASSERT(memcmp(buf, ret, sizeof(buf)) == 0);
+            }
+            close(fd);
+            ++ok_cnt;
+        }, i % 2, 0, stack_type);
+        fp.Run([fd = sv[1]](){
+            char buf[16];
+            while(recv(fd, buf, sizeof(buf), MSG_WAITALL) == sizeof(buf)){
+                MYRPC_ASSERT(write(fd, buf, sizeof(buf)) == sizeof(buf));
+            }
+            close(fd);
+        }, (i + 1) % 2);
+    }
+
+    // 普通文件的读写
+    std::atomic<bool> file_ok = false;
+    fp.Run([&file_ok](){
+        char path[] = "/tmp/myrpc_io_uring_XXXXXX";
+        int fd = mkstemp(path);
+        MYRPC_SYS_ASSERT(fd >= 0);
+        unlink(path);
+        const char content[] = "hello io_uring";
+        MYRPC_ASSERT(write(fd, content, sizeof(content)) == sizeof(content));
+        MYRPC_SYS_ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+        char buf[sizeof(content)];
+        MYRPC_ASSERT(read(fd, buf, sizeof(buf)) == sizeof(buf));
+        file_ok = memcmp(buf, content, sizeof(content)) == 0;
+        close(fd);
+    });
+
+    fp.Wait();
+    fp.Stop();
+
+    std::cout << "backend: " << backend << ", io_uring threads: " << uring_threads
+              << ", finished pairs: " << ok_cnt << std::endl;
+    MYRPC_ASSERT(ok_cnt == PAIR_NUM);
+    MYRPC_ASSERT(file_ok);
+    if(backend == EventManager::EPOLL_BACKEND) MYRPC_ASSERT(uring_threads == 0);
+}
+
+int main(){
+    ping_pong(EventManager::EPOLL_BACKEND);
+    ping_pong(EventManager::IO_URING_BACKEND);
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "fiber/fd_state.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace MyRPC;
+
+#define CONN_NUM 20
+#define MSG_NUM 50
+
+int create_listen_socket(sockaddr_in& addr){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    MYRPC_SYS_ASSERT(fd >= 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = 0;
+    MYRPC_SYS_ASSERT(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    MYRPC_SYS_ASSERT(getsockname(fd, (sockaddr*)&addr, &len) == 0);
+    MYRPC_SYS_ASSERT(listen(fd, 128) == 0);
+    return fd;
+}
+
+// 客户端连续发送多个请求后再读取回复，服务端读取时数据大多已经在缓冲区中
+void echo_test(){
+    FiberPool fp(2);
+    fp.Start();
+
+    sockaddr_in addr;
+    int listen_fd = create_listen_socket(addr);
+
+    std::atomic<int> ok_cnt = 0;
+    fp.Run([&fp, listen_fd](){
+        for(int i = 0; i < CONN_NUM; i++){
+            int conn = accept(listen_fd, nullptr, nullptr);
+            MYRPC_SYS_ASSERT(conn >= 0);
+            fp.Run([conn](){
+                int val;
+                while(read(conn, &val, sizeof(val)) == sizeof(val)){
+                    MYRPC_ASSERT(write(conn, &val, sizeof(val)) == sizeof(val));
+                }
+                close(conn);
+            });
+        }
+    }, 0);
+
+    for(int i = 0; i < CONN_NUM; i++){
+        fp.Run([&ok_cnt, addr](){
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            MYRPC_SYS_ASSERT(fd >= 0);
+            MYRPC_SYS_ASSERT(connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+            // connect完成后恢复为阻塞模式
+            MYRPC_ASSERT(!(fcntl(fd, F_GETFL, 0) & O_NONBLOCK));
+            for(int m = 0; m < MSG_NUM; m++) MYRPC_ASSERT(write(fd, &m, sizeof(m)) == sizeof(m));
+            int m;
+            for(m = 0; m < MSG_NUM; m++){
+                int val;
+                if(recv(fd, &val, sizeof(val), MSG_WAITALL) != sizeof(val) || val != m) break;
+            }
+            if(m == MSG_NUM) ++ok_cnt;
+            close(fd);
+        }, 1);
+    }
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "echo connections: " << ok_cnt << std::endl;
+    MYRPC_ASSERT(ok_cnt == CONN_NUM);
+
+    // 监听socket被hook函数设置为了非阻塞模式，在协程之外调用accept仍然会阻塞
+    std::thread client([addr](){
+        usleep(100000);
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        MYRPC_SYS_ASSERT(connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+        close(fd);
+    });
+    int conn = accept(listen_fd, nullptr, nullptr);
+    MYRPC_SYS_ASSERT(conn >= 0);
+    close(conn);
+    client.join();
+    close(listen_fd);
+}
+
+// 用户设置了O_NONBLOCK的socket，在协程中仍然是非阻塞的
+void user_nonblock_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<bool> ok = false;
+    fp.Run([&ok](){
+        int sv[2];
+        MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        MYRPC_SYS_ASSERT(fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL, 0) | O_NONBLOCK) == 0);
+        char buf[8];
+        MYRPC_ASSERT(read(sv[1], buf, sizeof(buf)) == -1 && errno == EAGAIN);
+        MYRPC_ASSERT(recv(sv[1], buf, sizeof(buf), 0) == -1 && errno == EAGAIN);
+        MYRPC_ASSERT(write(sv[0], "abc", 3) == 3);
+        MYRPC_ASSERT(read(sv[1], buf, sizeof(buf)) == 3);
+        close(sv[0]);
+        close(sv[1]);
+        ok = true;
+    });
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+}
+
+// fd被绕过hook的方式关闭后编号被复用，之前缓存的类型和标志位不能影响新的fd
+void stale_fd_state_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<bool> ok = false;
+    fp.Run([&ok](){
+        char buf[8];
+
+        // 缓存为socket的编号被管道复用
+        int sv[2], p[2];
+        MYRPC_SYS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        MYRPC_ASSERT(write(sv[0], "abc", 3) == 3);
+        MYRPC_SYS_ASSERT(syscall(SYS_close, sv[0]) == 0);
+        MYRPC_SYS_ASSERT(pipe(p) == 0);
+        MYRPC_ASSERT(p[0] == sv[0]);
+        MYRPC_ASSERT(write(p[1], "abc", 3) == 3);
+        MYRPC_ASSERT(read(p[0], buf, sizeof(buf)) == 3);
+        close(p[0]);
+        close(p[1]);
+        close(sv[1]);
+
+        // 监听socket上hook函数设置的非阻塞标志，不能使复用该编号的socket忽略用户设置的O_NONBLOCK
+        sockaddr_in addr;
+        int listen_fd = create_listen_socket(addr);
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        MYRPC_SYS_ASSERT(connect(client, (sockaddr*)&addr, sizeof(addr)) == 0);
+        int conn = accept(listen_fd, nullptr, nullptr);
+        MYRPC_SYS_ASSERT(conn >= 0);
+        MYRPC_ASSERT(FdState::GetFlags(listen_fd) & FdState::HOOK_NONBLOCK);
+        MYRPC_SYS_ASSERT(syscall(SYS_close, listen_fd) == 0);
+        MYRPC_SYS_ASSERT(syscall(SYS_socketpair, AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        MYRPC_ASSERT(sv[0] == listen_fd);
+        MYRPC_SYS_ASSERT(fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL, 0) | O_NONBLOCK) == 0);
+        MYRPC_ASSERT(read(sv[0], buf, sizeof(buf)) == -1 && errno == EAGAIN);
+        close(sv[0]);
+        close(sv[1]);
+        close(conn);
+        close(client);
+
+        // 缓存为普通文件的编号被socket复用，不能转移到阻塞IO线程池
+        char path[] = "/tmp/myrpc_stale_fd_XXXXXX";
+        int file = mkstemp(path);
+        MYRPC_SYS_ASSERT(file >= 0);
+        unlink(path);
+        MYRPC_ASSERT(read(file, buf, sizeof(buf)) == 0);
+        MYRPC_ASSERT(FdState::GetFlags(file) & FdState::REGULAR_FILE);
+        MYRPC_SYS_ASSERT(syscall(SYS_close, file) == 0);
+        MYRPC_SYS_ASSERT(syscall(SYS_socketpair, AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        MYRPC_ASSERT(sv[0] == file);
+        MYRPC_ASSERT(write(sv[1], "abc", 3) == 3);
+        MYRPC_ASSERT(read(sv[0], buf, sizeof(buf)) == 3);
+        MYRPC_ASSERT(FdState::GetFlags(sv[0]) & FdState::SOCKET);
+        close(sv[1]);
+
+        // dup2覆盖缓存为socket的编号
+        MYRPC_SYS_ASSERT(pipe(p) == 0);
+        MYRPC_SYS_ASSERT(dup2(p[0], sv[0]) == sv[0]);
+        MYRPC_ASSERT(!(FdState::GetFlags(sv[0]) & FdState::SOCKET));
+        MYRPC_ASSERT(write(p[1], "abc", 3) == 3);
+        MYRPC_ASSERT(read(sv[0], buf, sizeof(buf)) == 3);
+        close(sv[0]);
+        close(p[0]);
+        close(p[1]);
+        ok = true;
+    });
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok);
+}
+
+int main(){
+    echo_test();
+    user_nonblock_test();
+    stale_fd_state_test();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/offload_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+using namespace MyRPC;
+
+#define FIBER_NUM 100
+
+uint64_t fibonacci(int n){
+    return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+// 计算期间同一线程上的其他协程可以继续执行，计算结果和异常返回给调用的协程
+void offload_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    std::atomic<bool> done = false;
+    std::atomic<int> tick = 0, tick_during_offload = 0;
+    fp.Run([&](){
+        while(!done){
+            ++tick;
+            Fiber::Suspend();
+        }
+    });
+    fp.Run([&](){
+        auto start = tick.load();
+        auto ret = fp.Offload([](){ return fibonacci(32); });
+        tick_during_offload = tick - start;
+        MYRPC_ASSERT(ret == 2178309);
+
+        bool caught = false;
+        try{
+            fp.Offload([]() -> int { throw std::runtime_error("offload"); });
+        }catch(std::runtime_error& e){
+            caught = true;
+        }
+        MYRPC_ASSERT(caught);
+
+        int val = 0;
+        fp.Offload([&val](){ val = 1; });
+        MYRPC_ASSERT(val == 1);
+        done = true;
+    });
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "ticks during offload: " << tick_during_offload << std::endl;
+    MYRPC_ASSERT(tick_during_offload > 0);
+}
+
+// 多个协程同时转移执行
+void concurrent_test(){
+    FiberPool fp(2);
+    fp.SetOffloadAttr(4);
+    fp.Start();
+
+    std::atomic<int> ok_cnt = 0;
+    for(int i = 0; i < FIBER_NUM; i++){
+        fp.Run([&fp, &ok_cnt, i](){
+            if(fp.Offload([i](){ return fibonacci(i % 20); }) == fibonacci(i % 20)) ++ok_cnt;
+        });
+    }
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(ok_cnt == FIBER_NUM);
+}
+
+// 线程数量随任务增加，不超过上限，空闲后退出
+void elastic_test(){
+    OffloadPool pool(4, 0, std::chrono::milliseconds(100));
+    std::atomic<int> running = 0, finished = 0;
+    for(int i = 0; i < 8; i++){
+        pool.Submit([&running, &finished](){
+            ++running;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            --running;
+            ++finished;
+        });
+    }
+    MYRPC_ASSERT(pool.GetThreadsNum() == 4);
+    while(finished < 8) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    MYRPC_ASSERT(pool.GetThreadsNum() == 0);
+
+    pool.Submit([&finished](){ ++finished; });
+    pool.Stop();
+    MYRPC_ASSERT(finished == 9);
+}
+
+int main(){
+    offload_test();
+    concurrent_test();
+    elastic_test();
+    std::cout << "test_fiber_offload passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "fiber/fiber.h"
+#include "fiber/fiber_pool.h"
+#include "macro.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+using namespace MyRPC;
+
+#define FIBER_COUNT 100000
+#define SUSPEND_TIMES 3
+#define NUM_THREADS 4
+
+// 在协程栈上写入与协程相关的数据，每次恢复执行后检查数据是否被其他协程破坏
+void check_stack(int id, int& checked){
+    volatile int buf[64];
+    for(int i = 0; i < 64; i++) buf[i] = id * 64 + i;
+    for(int k = 0; k < SUSPEND_TIMES; k++){
+        Fiber::Suspend();
+        for(int i = 0; i < 64; i++) MYRPC_ASSERT(buf[i] == id * 64 + i);
+        ++checked;
+    }
+}
+
+class A{
+public:
+    A(int& cnt): m_cnt(cnt){}
+    ~A(){ ++m_cnt; }
+private:
+    int& m_cnt;
+};
+
+int main()
+{
+    // 大量交替执行的共享栈协程
+    int checked = 0;
+    std::vector<Fiber::ptr> fibers;
+    fibers.reserve(FIBER_COUNT);
+    for(int i = 0; i < FIBER_COUNT; i++){
+        fibers.emplace_back(new Fiber([i, &checked](){
+            check_stack(i, checked);
+        }, 0, StackPool::SHARED_STACK));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for(int k = 0; k <= SUSPEND_TIMES; k++){
+        for(auto& f: fibers) f->Resume();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+    std::cout << "Run " << FIBER_COUNT << " fibers on a shared stack in: " << elapsed_seconds.count() << "s" << std::endl;
+
+    MYRPC_ASSERT(checked == FIBER_COUNT * SUSPEND_TIMES);
+    for(auto& f: fibers) MYRPC_ASSERT(f->GetStatus() == Fiber::TERMINAL);
+    fibers.clear();
+
+    // 换出到保存缓冲区中的共享栈协程，析构时仍然可以进行栈回溯
+    int destructed = 0;
+    {
+        Fiber f([&destructed](){
+            A a(destructed);
+            Fiber::Suspend();
+        }, 0, StackPool::SHARED_STACK);
+        Fiber g([&destructed](){
+            A a(destructed);
+            Fiber::Suspend();
+        }, 0, StackPool::SHARED_STACK);
+        f.Resume();
+        g.Resume(); // f的栈被换出
+    }
+    MYRPC_ASSERT(destructed == 2);
+
+    // 协程池中使用共享栈运行协程
+    FiberPool fp(NUM_THREADS);
+    fp.Start();
+    std::atomic<int> fiber_cnt = 0;
+    for(int i = 0; i < 1000; i++){
+        fp.Run([i, &fiber_cnt](){
+            int checked = 0;
+            check_stack(i, checked);
+            MYRPC_ASSERT(checked == SUSPEND_TIMES);
+            ++fiber_cnt;
+        }, i % NUM_THREADS, 0, StackPool::SHARED_STACK);
+    }
+    fp.Wait();
+    fp.Stop();
+    std::cout << "Total fiber count: " << fiber_cnt << std::endl;
+    MYRPC_ASSERT(fiber_cnt == 1000);
+    return 0;
+}
@@ -13,13 +13,14 @@ long frac(int x){
     std::cout << "stack free size: " << Fiber::GetStackFreeSize() << ", stack total size:" << Fiber::GetStacksize() << std::endl;
     if((float)(Fiber::GetStackFreeSize())/Fiber::GetStacksize() < 0.2){
         std::cout << "Fiber stack realloc!" << std::endl;
-        Fiber::ExtendStackCapacity();
+        MYRPC_ASSERT(Fiber::ExtendStackCapacity());
     }
     if(x == 0) res = 1;
     else {
         res = res * frac(x-1);
         res -= 5;
     }
+    return res;
 }
 
 void fiber_1(){
@@ -28,7 +29,7 @@ void fiber_1(){
 
 int main()
 {
-    Fiber f(fiber_1);
+    Fiber f(fiber_1, StackPool::MIN_STACK_SIZE, StackPool::GROWABLE_STACK);
 
     std::cin >> oprand;
 
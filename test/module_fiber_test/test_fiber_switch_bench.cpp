@@ -0,0 +1,50 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+using namespace MyRPC;
+
+#define FIBER_COUNT 100
+#define SWITCH_TIMES 100000
+
+int main(){
+    // 1. 直接调用Resume/Suspend的上下文切换开销
+    {
+        Fiber f([](){
+            for(int i = 0; i < SWITCH_TIMES; i++) Fiber::Suspend();
+        });
+        auto start = std::chrono::high_resolution_clock::now();
+        while(f.GetStatus() != Fiber::TERMINAL) f.Resume();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> elapsed = end - start;
+        std::cout << "Resume/Suspend: " << elapsed.count() / SWITCH_TIMES << " ns per switch" << std::endl;
+    }
+
+    // 2. 经过协程池任务队列调度的上下文切换开销
+    {
+        FiberPool fp(1);
+        fp.Start();
+
+        std::atomic<int> finished = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int i = 0; i < FIBER_COUNT; i++){
+            fp.Run([&finished](){
+                for(int k = 0; k < SWITCH_TIMES; k++) Fiber::Suspend();
+                ++finished;
+            }, 0);
+        }
+        while(finished < FIBER_COUNT) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> elapsed = end - start;
+        std::cout << "FiberPool scheduling: " << elapsed.count() / ((double)FIBER_COUNT * SWITCH_TIMES)
+                  << " ns per switch" << std::endl;
+
+        fp.Stop();
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <sched.h>
+
+using namespace MyRPC;
+
+#define THREAD_NUM 4
+#define FIBER_NUM 100
+
+// 获得当前进程可以使用的CPU列表
+std::vector<int> get_allowed_cpus(){
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    MYRPC_SYS_ASSERT(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0);
+    std::vector<int> cpus;
+    for(int i = 0; i < CPU_SETSIZE; i++){
+        if(CPU_ISSET(i, &cpu_set)) cpus.push_back(i);
+    }
+    return cpus;
+}
+
+// 线程i运行在cpus[i % cpus.size()]上
+void affinity_test(){
+    auto cpus = get_allowed_cpus();
+    MYRPC_ASSERT(!cpus.empty());
+    if(cpus.size() > 2) cpus.resize(2);
+
+    FiberPool fp(THREAD_NUM);
+    fp.SetCpuAffinity(cpus);
+    fp.Start();
+
+    std::atomic<int> ok_cnt = 0;
+    for(int i = 0; i < FIBER_NUM; i++){
+        int thread_id = i % THREAD_NUM;
+        fp.Run([&ok_cnt, &cpus, thread_id](){
+            Fiber::Suspend();
+            if(FiberPool::GetCurrentThreadId() == thread_id &&
+               sched_getcpu() == cpus[thread_id % cpus.size()]) ++ok_cnt;
+        }, thread_id);
+    }
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "fibers on expected cpu: " << ok_cnt << std::endl;
+    MYRPC_ASSERT(ok_cnt == FIBER_NUM);
+}
+
+// 无法绑定的CPU不影响协程池运行
+void invalid_cpu_test(){
+    FiberPool fp(2);
+    fp.SetCpuAffinity({-1, CPU_SETSIZE});
+    fp.Start();
+
+    std::atomic<int> cnt = 0;
+    for(int i = 0; i < FIBER_NUM; i++) fp.Run([&cnt](){ ++cnt; });
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(cnt == FIBER_NUM);
+}
+
+int main(){
+    affinity_test();
+    invalid_cpu_test();
+    std::cout << "test_fiberpool_affinity passed" << std::endl;
+    return 0;
+}
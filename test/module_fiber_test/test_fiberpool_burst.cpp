@@ -0,0 +1,64 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <sched.h>
+
+using namespace MyRPC;
+
+#define BURST_SIZE 20000
+
+struct Node: public TaskQueueNode{
+    int id;
+};
+
+int main(){
+    // 1. 环形队列已满时，溢出到链表中
+    {
+        static Node nodes[BURST_SIZE];
+        TaskQueue<Node, 1024> queue;
+        for(int i = 0; i < BURST_SIZE; i++){
+            nodes[i].id = i;
+            queue.Push(&nodes[i]);
+        }
+        auto stat = queue.GetStatistics();
+        MYRPC_ASSERT(stat.overflow_count > 0);
+        MYRPC_ASSERT(queue.Size() == BURST_SIZE);
+
+        long long sum = 0;
+        Node* node;
+        while(queue.TryPop(node)) sum += node->id;
+        MYRPC_ASSERT(sum == (long long)BURST_SIZE * (BURST_SIZE - 1) / 2);
+        MYRPC_ASSERT(queue.GetStatistics().overflow_size == 0);
+    }
+
+    // 2. 突发的大量任务
+    FiberPool fp(1);
+    fp.Start();
+
+    // 阻塞线程0，使得突发的任务全部积压在任务队列中
+    std::atomic<bool> burst_done = false;
+    fp.Run([&burst_done](){
+        while(!burst_done) sched_yield();
+    }, 0);
+
+    std::atomic<int> fiber_cnt = 0;
+    for(int i = 0; i < BURST_SIZE; i++){
+        fp.Run([&fiber_cnt](){
+            Fiber::Suspend();
+            ++fiber_cnt;
+        }, 0);
+    }
+
+    burst_done = true;
+
+    fp.Wait();
+
+    std::cout << "Total fiber count: " << fiber_cnt << std::endl;
+    MYRPC_ASSERT(fiber_cnt == BURST_SIZE);
+
+    fp.Stop();
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+
+using namespace MyRPC;
+
+#define ROUND_NUM 200
+
+// 每隔一小段时间向线程0提交一个协程并等待其执行完成，返回平均往返时间（微秒）
+double round_trip(FiberPool& fp){
+    std::atomic<int> done = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < ROUND_NUM; i++){
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        fp.Run([&done](){ ++done; }, 0);
+        while(done <= i) std::this_thread::sleep_for(std::chrono::microseconds(1));
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return (double)us / ROUND_NUM;
+}
+
+void park_test(){
+    FiberPool fp(1);
+    fp.Start();
+    auto latency = round_trip(fp);
+    auto stat = fp.GetStatistics();
+    fp.Stop();
+
+    std::cout << "PARK: round trip " << latency << "us, wakeup count: " << stat.wakeup_count
+              << ", park count: " << stat.park_count << std::endl;
+    MYRPC_ASSERT(stat.spin_count == 0);
+    MYRPC_ASSERT(stat.park_count > 0);
+}
+
+void spin_test(){
+    FiberPool fp(1);
+    fp.SetIdlePolicy(FiberPool::SPIN_THEN_PARK, 1000);
+    fp.Start();
+    auto latency = round_trip(fp);
+
+    // 自旋期间发生的IO事件同样可以被处理
+    int pipe_fd[2];
+    MYRPC_SYS_ASSERT(pipe(pipe_fd) == 0);
+    std::atomic<bool> read_done = false;
+    fp.Run([&read_done, &pipe_fd](){
+        char c;
+        MYRPC_ASSERT(read(pipe_fd[0], &c, 1) == 1);
+        read_done = true;
+    }, 0);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    char c = 'a';
+    MYRPC_ASSERT(write(pipe_fd[1], &c, 1) == 1);
+    while(!read_done) std::this_thread::sleep_for(std::chrono::microseconds(10));
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+
+    auto stat = fp.GetStatistics();
+    fp.Stop();
+
+    std::cout << "SPIN_THEN_PARK: round trip " << latency << "us, wakeup count: " << stat.wakeup_count
+              << ", park count: " << stat.park_count << ", spin count: " << stat.spin_count
+              << ", spin hit count: " << stat.spin_hit_count << std::endl;
+    MYRPC_ASSERT(stat.spin_count > 0);
+    MYRPC_ASSERT(stat.spin_hit_count > 0 && stat.spin_hit_count <= stat.spin_count);
+}
+
+int main(){
+    park_test();
+    spin_test();
+    std::cout << "test_fiberpool_idle_spin passed" << std::endl;
+    return 0;
+}
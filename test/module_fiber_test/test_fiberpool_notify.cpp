@@ -0,0 +1,56 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <sched.h>
+
+using namespace MyRPC;
+
+#define SPAWN_NUM 10000
+
+int main(){
+    FiberPool fp(2);
+    fp.Start();
+
+    // 1. 线程忙碌时提交协程，不需要通过eventfd唤醒
+    std::atomic<bool> spawn_done = false;
+    fp.Run([&spawn_done](){
+        while(!spawn_done) sched_yield();
+    }, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto wakeup_before = fp.GetStatistics(0).wakeup_count;
+    std::atomic<int> fiber_cnt = 0;
+    for(int i = 0; i < SPAWN_NUM; i++){
+        fp.Run([&fiber_cnt](){
+            ++fiber_cnt;
+        }, 0);
+    }
+    auto wakeups = fp.GetStatistics(0).wakeup_count - wakeup_before;
+    spawn_done = true;
+
+    std::cout << "Spawn " << SPAWN_NUM << " fibers to a busy thread, wakeup count: " << wakeups << std::endl;
+    MYRPC_ASSERT(wakeups == 0);
+
+    // 2. 线程休眠时提交协程，线程必须被唤醒
+    for(int round = 0; round < 100; round++){
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        fp.Run([&fiber_cnt](){
+            ++fiber_cnt;
+        }, round % 2);
+    }
+
+    fp.Wait();
+
+    auto stat = fp.GetStatistics();
+    std::cout << "Total fiber count: " << fiber_cnt << ", total wakeup count: " << stat.wakeup_count << std::endl;
+    MYRPC_ASSERT(fiber_cnt == SPAWN_NUM + 100);
+    MYRPC_ASSERT(stat.wakeup_count < SPAWN_NUM / 10);
+
+    fp.Stop();
+    return 0;
+}
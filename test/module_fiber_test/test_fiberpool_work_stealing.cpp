@@ -0,0 +1,72 @@
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <mutex>
+
+using namespace MyRPC;
+
+#define NUM_THREADS 4
+#define FIBER_COUNT 64
+#define WORK_ROUNDS 200
+
+// 模拟计算密集型的任务，每计算一段时间让出一次CPU
+void busy_work(){
+    for(int r = 0; r < WORK_ROUNDS; r++){
+        volatile uint64_t x = 0;
+        for(int i = 0; i < 20000; i++) x += i;
+        Fiber::Suspend();
+    }
+}
+
+double run(bool work_stealing, int& used_threads){
+    FiberPool fp(NUM_THREADS);
+    fp.SetWorkStealing(work_stealing);
+    fp.Start();
+
+    std::atomic<int> finished = 0;
+    std::mutex threads_mutex;
+    std::set<int> threads;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    // 所有任务都由线程0上的一个协程创建，不开启工作窃取时，任务集中在线程0上执行
+    fp.Run([&](){
+        for(int i = 0; i < FIBER_COUNT; i++){
+            FiberPool::GetThis()->Run([&](){
+                busy_work();
+                {
+                    std::lock_guard<std::mutex> lock(threads_mutex);
+                    threads.insert(FiberPool::GetCurrentThreadId());
+                }
+                ++finished;
+            }, work_stealing ? -1 : 0);
+        }
+    }, 0);
+    while(finished < FIBER_COUNT) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto stat = fp.GetStatistics();
+    std::cout << "work stealing: " << work_stealing << ", steal count: " << stat.steal_count << ", stolen fibers: "
+              << stat.stolen_fiber_count << ", steal failed: " << stat.steal_fail_count << std::endl;
+    fp.Stop();
+
+    used_threads = threads.size();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(){
+    int used_threads;
+    auto t1 = run(false, used_threads);
+    std::cout << "Without work stealing: " << t1 << "s, " << used_threads << " threads used" << std::endl;
+    MYRPC_ASSERT(used_threads == 1);
+
+    auto t2 = run(true, used_threads);
+    std::cout << "With work stealing: " << t2 << "s, " << used_threads << " threads used" << std::endl;
+    MYRPC_ASSERT(used_threads > 1);
+    return 0;
+}
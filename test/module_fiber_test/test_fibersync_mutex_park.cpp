@@ -0,0 +1,104 @@
+#include "fiber/fiber_sync.h"
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <ctime>
+#include <unistd.h>
+
+using namespace MyRPC;
+
+#define THREADS_NUM 4
+#define FIBER_COUNT 1000
+#define WAITER_NUM 100
+
+// 多个线程上的协程竞争同一个锁，持有锁期间让出CPU
+void counter_test(FiberSync::Mutex::Mode mode, int spin_count){
+    FiberPool fp(THREADS_NUM);
+    fp.Start();
+
+    FiberSync::Mutex mutex(mode, spin_count);
+    int count = 0;
+    for(int i = 0; i < FIBER_COUNT; i++){
+        fp.Run([&mutex, &count](){
+            std::unique_lock<FiberSync::Mutex> lock(mutex);
+            int val = count;
+            Fiber::Suspend();
+            count = val + 1;
+        }, i % THREADS_NUM);
+    }
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(count == FIBER_COUNT);
+}
+
+// 等待锁的协程阻塞，不占用任务队列，线程可以休眠
+void park_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    FiberSync::Mutex mutex;
+    std::atomic<int> count = 0;
+    fp.Run([&mutex](){
+        std::unique_lock<FiberSync::Mutex> lock(mutex);
+        usleep(100000);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for(int i = 0; i < WAITER_NUM; i++){
+        fp.Run([&mutex, &count](){
+            std::unique_lock<FiberSync::Mutex> lock(mutex);
+            ++count;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // 所有协程都在等待时，进程几乎不占用CPU时间
+    auto cpu_before = clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto cpu_ms = (clock() - cpu_before) * 1000 / CLOCKS_PER_SEC;
+
+    fp.Wait();
+    fp.Stop();
+    std::cout << "cpu time while waiting for the lock: " << cpu_ms << "ms" << std::endl;
+    MYRPC_ASSERT(count == WAITER_NUM);
+    MYRPC_ASSERT(cpu_ms < 10);
+}
+
+// HANDOFF模式下按照等待的顺序获得锁，锁可以由协程池之外的线程释放
+void handoff_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    FiberSync::Mutex mutex(FiberSync::Mutex::HANDOFF);
+    std::vector<int> order;
+    mutex.lock();
+    for(int i = 0; i < WAITER_NUM; i++){
+        fp.Run([&mutex, &order, i](){
+            std::unique_lock<FiberSync::Mutex> lock(mutex);
+            order.push_back(i);
+            Fiber::Suspend();
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    mutex.unlock();
+
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(order.size() == WAITER_NUM);
+    for(int i = 0; i < WAITER_NUM; i++) MYRPC_ASSERT(order[i] == i);
+}
+
+int main(){
+    counter_test(FiberSync::Mutex::BARGING, 0);
+    counter_test(FiberSync::Mutex::BARGING, 100);
+    counter_test(FiberSync::Mutex::HANDOFF, 0);
+    park_test();
+    handoff_test();
+    std::cout << "test_fibersync_mutex_park passed" << std::endl;
+    return 0;
+}
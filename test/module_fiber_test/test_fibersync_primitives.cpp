@@ -0,0 +1,128 @@
+#include "fiber/fiber_sync.h"
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <ctime>
+
+using namespace MyRPC;
+
+#define THREADS_NUM 4
+#define PRODUCER_NUM 8
+#define CONSUMER_NUM 8
+#define ITEM_PER_PRODUCER 1000
+#define SEM_COUNT 3
+#define WORKER_NUM 100
+
+// 生产者-消费者，消费者在条件变量上等待
+void cv_test(){
+    FiberPool fp(THREADS_NUM);
+    fp.Start();
+
+    FiberSync::Mutex mutex;
+    FiberSync::ConditionVariable<FiberSync::Mutex> cv;
+    std::queue<int> queue;
+    int produced = 0;
+    int64_t sum = 0;
+    FiberSync::WaitGroup wg;
+
+    wg.Add(PRODUCER_NUM + CONSUMER_NUM);
+    for(int i = 0; i < CONSUMER_NUM; i++){
+        fp.Run([&](){
+            while(true){
+                std::unique_lock<FiberSync::Mutex> lock(mutex);
+                cv.wait(mutex, [&](){ return !queue.empty() || produced == PRODUCER_NUM * ITEM_PER_PRODUCER; });
+                if(queue.empty()) break;
+                sum += queue.front();
+                queue.pop();
+            }
+            wg.Done();
+        }, i % THREADS_NUM);
+    }
+    for(int i = 0; i < PRODUCER_NUM; i++){
+        fp.Run([&](){
+            for(int j = 1; j <= ITEM_PER_PRODUCER; j++){
+                std::unique_lock<FiberSync::Mutex> lock(mutex);
+                queue.push(j);
+                if(++produced == PRODUCER_NUM * ITEM_PER_PRODUCER) cv.notify_all();
+                else cv.notify_one();
+            }
+            wg.Done();
+        }, i % THREADS_NUM);
+    }
+
+    wg.Wait(); // 协程池之外的线程也可以等待
+    fp.Stop();
+    MYRPC_ASSERT(sum == (int64_t)PRODUCER_NUM * ITEM_PER_PRODUCER * (ITEM_PER_PRODUCER + 1) / 2);
+}
+
+// 同时持有信号量的协程数量不超过SEM_COUNT
+void semaphore_test(){
+    FiberPool fp(THREADS_NUM);
+    fp.Start();
+
+    FiberSync::Semaphore sem(SEM_COUNT);
+    std::atomic<int> holding = 0;
+    std::atomic<int> max_holding = 0;
+    FiberSync::Latch done(WORKER_NUM);
+
+    for(int i = 0; i < WORKER_NUM; i++){
+        fp.Run([&](){
+            sem.acquire();
+            int n = ++holding;
+            int max = max_holding.load();
+            while(n > max && !max_holding.compare_exchange_weak(max, n));
+            Fiber::Suspend();
+            --holding;
+            sem.release();
+            done.count_down();
+        }, i % THREADS_NUM);
+    }
+
+    done.wait();
+    fp.Stop();
+    MYRPC_ASSERT(max_holding <= SEM_COUNT);
+    MYRPC_ASSERT(sem.try_acquire());
+}
+
+// Latch打开之前所有等待的协程都阻塞，不占用CPU
+void latch_test(){
+    FiberPool fp(1);
+    fp.Start();
+
+    FiberSync::Latch gate(1);
+    FiberSync::WaitGroup wg;
+    std::atomic<int> passed = 0;
+
+    wg.Add(WORKER_NUM);
+    for(int i = 0; i < WORKER_NUM; i++){
+        fp.Run([&](){
+            gate.wait();
+            ++passed;
+            wg.Done();
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto cpu_before = clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto cpu_ms = (clock() - cpu_before) * 1000 / CLOCKS_PER_SEC;
+    MYRPC_ASSERT(passed == 0 && !gate.try_wait());
+
+    gate.count_down();
+    wg.Wait();
+    fp.Stop();
+    std::cout << "cpu time while waiting for the latch: " << cpu_ms << "ms" << std::endl;
+    MYRPC_ASSERT(passed == WORKER_NUM);
+    MYRPC_ASSERT(cpu_ms < 10);
+}
+
+int main(){
+    cv_test();
+    semaphore_test();
+    latch_test();
+}
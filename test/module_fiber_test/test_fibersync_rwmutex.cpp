@@ -1,10 +1,12 @@
 #include "fiber/fiber_sync.h"
 #include "fiber/fiber_pool.h"
 #include "fiber/fiber.h"
+#include "macro.h"
 
 #include <mutex>
 #include <shared_mutex>
 #include <cstdlib>
+#include <chrono>
 #include <iostream>
 
 using namespace MyRPC;
@@ -13,27 +15,87 @@ using namespace MyRPC;
 #define WRITER_COUNT 128
 #define READER_COUNT 256
 
-int main(){
+#define BENCH_FIBERS_PER_THREAD 4
+#define BENCH_OPS_PER_FIBER 100000
+#define BENCH_WRITE_EVERY 1000
+
+// 读者在持有读锁期间让出CPU，写者不能与读者同时持有锁
+void correctness_test(){
     FiberPool fp(THREADS_NUM);
+    fp.Start();
 
     FiberSync::RWMutex rwlock;
-    volatile int var = 10;
+    int var = 10;
+    int var_copy = 10;
 
     for(int i=0; i<WRITER_COUNT; i++){
-        fp.Run([&rwlock, &var](){
+        fp.Run([&rwlock, &var, &var_copy](){
             std::unique_lock<FiberSync::RWMutex> lock(rwlock);
             var += 10;
+            Fiber::Suspend();
+            var_copy = var;
             Logger::info("write var: {}", var);
         }, rand()%THREADS_NUM);
     }
 
     for(int i=0; i<READER_COUNT; i++){
-        fp.Run([&rwlock, &var](){
+        fp.Run([&rwlock, &var, &var_copy](){
             std::shared_lock<FiberSync::RWMutex> lock_shared(rwlock);
+            int val = var;
+            Fiber::Suspend();
+            MYRPC_ASSERT(val == var && var == var_copy);
             Logger::info("read var: {}", var);
         }, rand()%THREADS_NUM);
     }
 
+    fp.Wait();
+    fp.Stop();
+    MYRPC_ASSERT(var == 10 + WRITER_COUNT * 10);
+}
+
+// 读多写少的负载，返回每次操作的平均耗时（纳秒）
+template<class RWLock>
+double bench(){
+    FiberPool fp(THREADS_NUM);
     fp.Start();
+
+    RWLock rwlock;
+    int64_t var = 0;
+    std::atomic<int64_t> sum = 0;
+    // FiberPool::Wait()按秒轮询，由最后完成的协程记录结束时间
+    std::atomic<int> remaining = THREADS_NUM * BENCH_FIBERS_PER_THREAD;
+    std::chrono::steady_clock::time_point end;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i<THREADS_NUM * BENCH_FIBERS_PER_THREAD; i++){
+        fp.Run([&rwlock, &var, &sum, &remaining, &end](){
+            int64_t local = 0;
+            for(int j=0; j<BENCH_OPS_PER_FIBER; j++){
+                if(j % BENCH_WRITE_EVERY == 0){
+                    std::unique_lock<RWLock> lock(rwlock);
+                    ++var;
+                }else{
+                    std::shared_lock<RWLock> lock(rwlock);
+                    local += var;
+                }
+            }
+            sum += local;
+            if(--remaining == 0) end = std::chrono::steady_clock::now();
+        }, i % THREADS_NUM);
+    }
     fp.Wait();
+    fp.Stop();
+
+    MYRPC_ASSERT(var == THREADS_NUM * BENCH_FIBERS_PER_THREAD * (BENCH_OPS_PER_FIBER / BENCH_WRITE_EVERY));
+    double ops = (double)THREADS_NUM * BENCH_FIBERS_PER_THREAD * BENCH_OPS_PER_FIBER;
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+int main(){
+    correctness_test();
+
+    auto fiber_ns = bench<FiberSync::RWMutex>();
+    auto std_ns = bench<std::shared_mutex>();
+    std::cout << "FiberSync::RWMutex: " << fiber_ns << " ns/op" << std::endl;
+    std::cout << "std::shared_mutex: " << std_ns << " ns/op" << std::endl;
 }
@@ -1,85 +1,122 @@
 #include "fiber/lockfree_queue.h"
+#include "macro.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
-#include "spinlock.h"
-#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
 
 using namespace std;
 using namespace MyRPC;
 
-const int NUM_COUNT = 100000;
-const int NUM_PROD_THREAD = 5;
-const int NUM_CONSUM_THREAD = 5;
-
-
-class Data
-{
-public:
-    Data(long i) : i_(i) {}
-    void dataPrint() {cout << "Hello";}
-
-    long i_;
-    double j;
-};
-
-Data* dataArray[NUM_COUNT];
-
-MPMCLockFreeQueue<Data*, 1024> q;
+const long NUM_COUNT = 1 << 20; // 每一轮入队、出队的元素总数
+const int MAX_THREAD = 64;
+const int BATCH_SIZE = 16;
+
+typedef MPMCLockFreeQueue<long, 1024> Queue;
+
+// 单线程下检查FIFO顺序、容量以及批量接口
+void basic_test(){
+    auto q = make_unique<Queue>();
+    long val;
+    MYRPC_ASSERT(q->Empty() && !q->TryPop(val));
+    for(long i = 0; i < 1024; i++) MYRPC_ASSERT(q->TryPush(i));
+    // 容量为QSIZE，没有浪费的槽位
+    MYRPC_ASSERT(q->Size() == 1024 && !q->TryPush(1024L));
+    for(long i = 0; i < 1024; i++) MYRPC_ASSERT(q->TryPop(val) && val == i);
+    MYRPC_ASSERT(q->Empty());
+
+    long in[100], out[100];
+    for(long i = 0; i < 100; i++) in[i] = i;
+    for(int round = 0; round < 30; round++){ // 位置绕回多次
+        MYRPC_ASSERT(q->TryPushBatch(in, 100) == 100);
+        MYRPC_ASSERT(q->TryPopBatch(out, 40) == 40 && q->TryPopBatch(out + 40, 100) == 60);
+        for(long i = 0; i < 100; i++) MYRPC_ASSERT(out[i] == i);
+    }
+    MYRPC_ASSERT(q->TryPopBatch(out, 100) == 0);
 
-SpinLock print_lock;
+    // 容量为1时仍然可以区分“满”和“空”
+    MPMCLockFreeQueue<long, 1> q1;
+    MYRPC_ASSERT(q1.TryPush(1L) && !q1.TryPush(2L));
+    MYRPC_ASSERT(q1.TryPop(val) && val == 1 && !q1.TryPop(val));
+    MYRPC_ASSERT(q1.TryPushBatch(in, 100) == 1 && q1.TryPopBatch(out, 100) == 1);
 
-struct Producer
-{
-    void operator()()
+    // 析构时释放队列中剩余的元素
+    auto counter = make_shared<int>(0);
     {
-        for(long i=0; i<NUM_COUNT; i++) {
-            while(!q.TryPush(dataArray[i]));
-        }
+        MPMCLockFreeQueue<shared_ptr<int>, 4> qp;
+        MYRPC_ASSERT(qp.TryPush(counter) && qp.TryPush(counter));
+        MYRPC_ASSERT(counter.use_count() == 3);
     }
-};
-
+    MYRPC_ASSERT(counter.use_count() == 1);
+}
 
-struct Consumer
-{
-    Data *pData;
-    long result_;
-    void operator()()
-    {
-        for(long i=0; i<NUM_COUNT; i++) {
-            while (!q.TryPop(pData));
-            {
-                std::unique_lock<SpinLock> lock(print_lock);
-                std::cout << pData->i_ << '\n';
+/**
+ * @brief num_thread个生产者和num_thread个消费者并发地入队、出队
+ * @return 每秒完成的入队+出队操作数（百万）
+ */
+double throughput_test(int num_thread, bool batch){
+    auto q = make_unique<Queue>();
+    atomic<long> consumed = 0;
+    atomic<long> sum = 0;
+    vector<thread> threads;
+
+    long per_producer = NUM_COUNT / num_thread;
+    long total = per_producer * num_thread;
+
+    auto start = chrono::steady_clock::now();
+    for(int p = 0; p < num_thread; p++){
+        threads.emplace_back([&, p](){
+            long buf[BATCH_SIZE];
+            long i = p * per_producer, end = i + per_producer;
+            while(i < end){
+                if(batch){
+                    long n = min((long)BATCH_SIZE, end - i);
+                    for(long k = 0; k < n; k++) buf[k] = i + k;
+                    long pushed = q->TryPushBatch(buf, n);
+                    i += pushed;
+                    if(pushed == 0) this_thread::yield();
+                }else{
+                    if(q->TryPush(i)) ++i;
+                    else this_thread::yield();
+                }
             }
-        }
+        });
     }
-};
+    for(int c = 0; c < num_thread; c++){
+        threads.emplace_back([&](){
+            long buf[BATCH_SIZE];
+            long local = 0;
+            while(consumed.load(memory_order_relaxed) < total){
+                long n = batch ? q->TryPopBatch(buf, BATCH_SIZE) : q->TryPop(buf[0]);
+                if(n == 0){
+                    this_thread::yield();
+                    continue;
+                }
+                for(long k = 0; k < n; k++) local += buf[k];
+                consumed.fetch_add(n, memory_order_relaxed);
+            }
+            sum += local;
+        });
+    }
+    for(auto& t: threads) t.join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    // 每个元素恰好被取出一次
+    MYRPC_ASSERT(consumed == total);
+    MYRPC_ASSERT(sum == total * (total - 1) / 2);
+    MYRPC_ASSERT(q->Empty());
+    return 2.0 * total / elapsed.count() / 1e6;
+}
 
 int main(){
-    std::thread thrd [NUM_PROD_THREAD + NUM_CONSUM_THREAD];
-
-    std::chrono::duration<double> elapsed_seconds;
-
-    for (int i = 0; i < NUM_COUNT; ++i) dataArray[i] = new Data(i);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    for ( int i = 0; i < NUM_PROD_THREAD;  i++ )
-        thrd[i] = std::thread{ Producer() };
+    basic_test();
 
-    for ( int i = 0; i < NUM_CONSUM_THREAD; i++ )
-        thrd[NUM_PROD_THREAD+i] = std::thread{Consumer()};
-
-    for ( int i = 0; i < NUM_CONSUM_THREAD; i++ )
-        thrd[NUM_PROD_THREAD+i].join();
-
-    auto end = std::chrono::high_resolution_clock::now();
-    elapsed_seconds = end - start;
-    std::cout << "Enqueue and Dequeue 1 million item in:"
-              << elapsed_seconds.count() << std::endl;
-
-    for ( int i = 0; i < NUM_PROD_THREAD; i++ )
-        thrd[i].join();
-    for (int i = 0; i < NUM_COUNT; ++i)
-        delete dataArray[i];
+    cout << "threads(P=C)\tsingle(Mops/s)\tbatch" << BATCH_SIZE << "(Mops/s)" << endl;
+    for(int n = 1; n <= MAX_THREAD; n *= 2){
+        double single = throughput_test(n, false);
+        double batch = throughput_test(n, true);
+        cout << n << "\t\t" << single << "\t\t" << batch << endl;
+    }
 }
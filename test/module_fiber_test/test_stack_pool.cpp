@@ -0,0 +1,67 @@
+#include "fiber/fiber.h"
+#include "fiber/stack_pool.h"
+#include "macro.h"
+
+#include <iostream>
+#include <chrono>
+
+using namespace MyRPC;
+
+#define FIBER_COUNT 100000
+#define MMAP_STACK_SIZE (1024 * 1024)
+
+// 在协程栈上使用大约depth KB的空间
+int deep_recursion(int depth){
+    volatile char buf[1024];
+    buf[0] = (char)depth;
+    if(depth == 0) return buf[0];
+    return deep_recursion(depth - 1) + buf[0];
+}
+
+int main()
+{
+    StackPool::SetHighWaterMark(16);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for(int i = 0; i < FIBER_COUNT; i++){
+        Fiber f([](){
+            Fiber::Suspend();
+        });
+        f.Resume();
+        f.Resume();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+
+    auto stat = StackPool::GetStatistics();
+    std::cout << "Create and run " << FIBER_COUNT << " fibers in: " << elapsed_seconds.count() << "s" << std::endl;
+    std::cout << "alloc: " << stat.alloc_count << ", free: " << stat.free_count << ", hit: " << stat.hit_count
+              << ", miss: " << stat.miss_count << ", cached: " << stat.cached_count << "(" << stat.cached_bytes << " bytes)" << std::endl;
+
+    MYRPC_ASSERT(stat.miss_count == 1);
+    MYRPC_ASSERT(stat.alloc_count == stat.free_count);
+
+    // mmap分配的大协程栈
+    int result = 0;
+    Fiber g([&result](){
+        result = deep_recursion(512);
+    }, MMAP_STACK_SIZE, StackPool::MMAP_STACK);
+    g.Resume();
+    std::cout << "Recursion on a " << MMAP_STACK_SIZE << " bytes mmap stack, result: " << result << std::endl;
+    MYRPC_ASSERT(g.GetStatus() == Fiber::TERMINAL);
+
+    // 从一个内存页开始，缺页时自动扩充的协程栈
+    size_t grown_size = 0;
+    Fiber h([&result, &grown_size](){
+        result = deep_recursion(256);
+        grown_size = Fiber::GetStacksize();
+    }, StackPool::MIN_STACK_SIZE, StackPool::GROWABLE_STACK);
+    h.Resume();
+    std::cout << "Recursion on a growable stack, result: " << result << ", stack grown to " << grown_size << " bytes" << std::endl;
+    MYRPC_ASSERT(h.GetStatus() == Fiber::TERMINAL);
+    MYRPC_ASSERT(grown_size > StackPool::MIN_STACK_SIZE);
+
+    StackPool::Shrink();
+    MYRPC_ASSERT(StackPool::GetStatistics().cached_count == 0);
+    return 0;
+}
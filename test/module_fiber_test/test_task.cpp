@@ -0,0 +1,48 @@
+#include "fiber/task.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <array>
+
+using namespace MyRPC;
+
+int main()
+{
+    // 1. 小的可调用对象保存在Task内部
+    auto counter = std::make_shared<int>(0);
+    std::string name = "service_name";
+    {
+        Task t([counter, name](){ ++*counter; });
+        t();
+        Task t2(std::move(t));
+        MYRPC_ASSERT(!t);
+        t2();
+        MYRPC_ASSERT(*counter == 2);
+        MYRPC_ASSERT(counter.use_count() == 2);
+    }
+    MYRPC_ASSERT(counter.use_count() == 1);
+
+    // 2. 超出内联缓冲区的可调用对象保存在堆上
+    {
+        std::array<char, Task::INLINE_SIZE * 2> big{};
+        Task t([counter, big](){ *counter += big.size(); });
+        Task t2;
+        t2 = std::move(t);
+        t2();
+        MYRPC_ASSERT(*counter == 2 + Task::INLINE_SIZE * 2);
+    }
+    MYRPC_ASSERT(counter.use_count() == 1);
+
+    // 3. 只能移动的可调用对象
+    auto unique = std::make_unique<int>(42);
+    int result = 0;
+    Fiber f([p = std::move(unique), &result](){ result = *p; });
+    f.Resume();
+    MYRPC_ASSERT(result == 42);
+
+    std::cout << "sizeof(Task): " << sizeof(Task) << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "fiber/timing_wheel.h"
+#include "fiber/fiber_pool.h"
+#include "fiber/fiber.h"
+#include "macro.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+using namespace MyRPC;
+
+#define TIMER_NUM 100000
+#define SLEEP_FIBER_NUM 1000
+
+struct Node: public TimerNode{
+    uint64_t expire;
+    bool canceled = false;
+    bool expired = false;
+};
+
+int main(){
+    // 1. 时间轮：定时器在超时时刻到达时被取出，既不提前也不遗漏
+    {
+        std::mt19937_64 rng(2022);
+        uint64_t start = 1000000007;
+        TimingWheel wheel(start);
+        std::vector<Node> nodes(TIMER_NUM);
+        for(auto& node: nodes){
+            // 覆盖第0层到第3层
+            node.expire = start + rng() % (1 << (rng() % 22 + 1));
+            wheel.Add(&node, node.expire);
+        }
+        for(int i = 0; i < TIMER_NUM; i += 3){
+            wheel.Remove(&nodes[i]);
+            nodes[i].canceled = true;
+        }
+        MYRPC_ASSERT(!nodes[0].IsTimerActive());
+
+        uint64_t now = start;
+        size_t expired_cnt = 0;
+        while(!wheel.Empty()){
+            auto timeout = wheel.NextTimeout(now);
+            MYRPC_ASSERT(timeout >= 0);
+            now += std::max<int64_t>(1, std::min<int64_t>(timeout, rng() % 5000));
+            wheel.Advance(now);
+            while(auto p = wheel.PopExpired()){
+                auto node = static_cast<Node*>(p);
+                MYRPC_ASSERT(!node->canceled && !node->expired);
+                MYRPC_ASSERT(node->expire <= now);
+                node->expired = true;
+                ++expired_cnt;
+            }
+            // 所有超时时刻不晚于now的定时器都已被取出
+            for(int i = 0; i < TIMER_NUM; i += 997){
+                if(!nodes[i].canceled && nodes[i].expire <= now) MYRPC_ASSERT(nodes[i].expired);
+            }
+        }
+        MYRPC_ASSERT(expired_cnt == TIMER_NUM - (TIMER_NUM + 2) / 3);
+        std::cout << "Timing wheel expired " << expired_cnt << " timers" << std::endl;
+    }
+
+    // 2. 协程中的sleep
+    FiberPool fp(2);
+    fp.Start();
+
+    std::atomic<int> early_cnt = 0, done_cnt = 0;
+    for(int i = 0; i < SLEEP_FIBER_NUM; i++){
+        fp.Run([i, &early_cnt, &done_cnt](){
+            useconds_t us = (i % 50 + 1) * 1000;
+            auto begin = std::chrono::steady_clock::now();
+            usleep(us);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count();
+            if(elapsed < us) ++early_cnt;
+            ++done_cnt;
+        });
+    }
+
+    fp.Wait();
+
+    std::cout << "Sleep fiber count: " << done_cnt << ", woken early: " << early_cnt << std::endl;
+    MYRPC_ASSERT(done_cnt == SLEEP_FIBER_NUM);
+    MYRPC_ASSERT(early_cnt == 0);
+
+    fp.Stop();
+    return 0;
+}
@@ -37,4 +37,9 @@ int main(int argc, char** argv){
 
     std::cout << future_echo.get() << std::endl;
 
+    std::promise<uint64_t> promise_fibonacci;
+    auto future_fibonacci = client.InvokeAsync(promise_fibonacci, "fibonacci", 30);
+
+    std::cout << future_fibonacci.get() << std::endl;
+
 }
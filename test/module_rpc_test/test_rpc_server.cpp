@@ -10,6 +10,10 @@ int func_add(int a, int b){
     return a+b;
 }
 
+uint64_t func_fibonacci(int n){
+    return n < 2 ? n : func_fibonacci(n - 1) + func_fibonacci(n - 2);
+}
+
 int main(int argc, char** argv){
     Config::ptr config(nullptr);
     if(argc >= 2){
@@ -45,5 +49,8 @@ int main(int argc, char** argv){
         return a*b;
     });
 
+    // 计算量较大的服务在工作线程池中执行，不阻塞同一线程上的其他连接
+    server.RegisterMethod("fibonacci", &func_fibonacci, true);
+
     server.Loop();
 }
\ No newline at end of file